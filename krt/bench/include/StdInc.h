@@ -0,0 +1,42 @@
+#pragma once
+
+// Precompiled header of the streaming benchmark.
+// Only has what the streaming system needs, so that the benchmark builds without
+// RenderWare and the rest of the engine (like on Linux).
+
+// containers
+#include <vector>
+#include <list>
+
+#include <map>
+#include <unordered_map>
+
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include <memory>
+#include <functional>
+
+#include <algorithm>
+#include <numeric>
+
+#include <string>
+#include <cstring>
+#include <stdexcept>
+
+// integer types
+#include <stdint.h>
+
+#include <cassert>
+
+// useful utilities
+#include <utils/LoopRange.h>
+#include <utils/LockUtil.h>
+
+// The streaming interfaces are declared with the MSVC abstract keyword.
+#ifndef _MSC_VER
+#define abstract
+#endif
@@ -0,0 +1,119 @@
+#pragma once
+
+// Synthetic resources of the streaming benchmark.
+// Reading and decoding only cost time, the data itself is made up.
+
+#include "Streaming.h"
+
+#include <chrono>
+
+namespace krt
+{
+namespace streaming
+{
+namespace bench
+{
+
+inline unsigned long long GetBenchTime( void )
+{
+    return (unsigned long long)std::chrono::duration_cast <std::chrono::microseconds> (
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+// Keeps the CPU busy like a real decoder would.
+inline void SpinFor( unsigned long long microseconds, const void *data, size_t dataSize )
+{
+    const unsigned long long endTime = GetBenchTime() + microseconds;
+
+    const unsigned char *bytes = (const unsigned char*)data;
+
+    volatile unsigned int checksum = 0;
+    size_t n = 0;
+
+    do
+    {
+        for ( size_t i = 0; i < 256 && n < dataSize; i++, n++ )
+        {
+            checksum = checksum + bytes[ n ];
+        }
+    }
+    while ( GetBenchTime() < endTime );
+}
+
+struct BenchLocation : public ResourceLocation
+{
+    inline BenchLocation( size_t dataSize, unsigned long long readTime ) : dataSize( dataSize ), readTime( readTime )
+    {
+        return;
+    }
+
+    size_t getDataSize( void ) const override
+    {
+        return this->dataSize;
+    }
+
+    void fetchData( void *dataBuf ) override
+    {
+        // The device is waited on, so the thread sleeps instead of spinning.
+        std::this_thread::sleep_for( std::chrono::microseconds( this->readTime ) );
+
+        memset( dataBuf, (int)( this->dataSize & 0xFF ), this->dataSize );
+    }
+
+private:
+    size_t dataSize;
+    unsigned long long readTime;    // microseconds
+};
+
+struct BenchType : public StreamingTypeInterface
+{
+    inline BenchType( ident_t numResources ) : decodeTimes( numResources, 0 ), residentSizes( numResources, 0 ), numLoads( 0 )
+    {
+        return;
+    }
+
+    // Has to be set before the resource is linked.
+    inline void SetCost( ident_t localID, unsigned long long decodeTime, size_t residentSize )
+    {
+        this->decodeTimes[ localID ] = decodeTime;
+        this->residentSizes[ localID ] = residentSize;
+    }
+
+    void LoadResource( ident_t localID, const void *data, size_t dataSize ) override
+    {
+        SpinFor( this->decodeTimes[ localID ], data, dataSize );
+
+        this->numLoads++;
+    }
+
+    void UnloadResource( ident_t localID ) override
+    {
+        return;
+    }
+
+    size_t GetObjectMemorySize( ident_t localID ) const override
+    {
+        return this->residentSizes[ localID ];
+    }
+
+    inline size_t GetNumLoads( void ) const
+    {
+        return this->numLoads;
+    }
+
+private:
+    std::vector <unsigned long long> decodeTimes;   // microseconds
+    std::vector <size_t> residentSizes;
+
+    std::atomic <size_t> numLoads;
+};
+
+// Drives a fresh streaming system with a recorded trace (see StreamMan::StartTrace)
+// and prints how it did for every channel count.
+// Pass a speed of zero to replay as fast as possible.
+int ReplayTrace( const char *tracePath, const std::vector <unsigned int>& channelCounts, double speed );
+
+}
+}
+}
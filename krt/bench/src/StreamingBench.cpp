@@ -0,0 +1,512 @@
+#include "StdInc.h"
+#include "StreamingBench.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+
+// Benchmark of the streaming system with synthetic resources.
+// Nothing is read from disk: reading and decoding are simulated with configurable costs,
+// so that scheduling changes of StreamMan can be measured the same way on any machine.
+
+namespace krt
+{
+namespace streaming
+{
+namespace bench
+{
+
+struct benchConfig_t
+{
+    unsigned int numModels = 4000;
+    unsigned int numTexDicts = 400;
+    unsigned int dependenciesPerModel = 1;  // models depend on texture dictionaries.
+
+    // Data sizes are spread log-uniform between these.
+    size_t minDataSize = 4 * 1024;
+    size_t maxDataSize = 512 * 1024;
+
+    unsigned int readLatency = 100;     // microseconds for every read.
+    double readBandwidth = 400.0;       // megabytes per second for every read.
+    double decodeCost = 2.0;            // microseconds of busy work per kilobyte.
+    double memoryInflation = 1.5;       // resident size compared to the data size.
+
+    size_t maxMemory = 256 * 1024 * 1024;
+    size_t rawCacheMemory = 0;
+    bool isRawCacheCompressed = false;
+    unsigned int numIOWorkers = 1;
+    unsigned int requestsPerFrame = 0;  // zero requests everything at once.
+    unsigned int numPasses = 1;         // every pass requests all models again, in the opposite order of the last one.
+
+    std::vector <unsigned int> channelCounts = { 1, 2, 4, 8 };
+
+    unsigned int seed = 1;
+
+    // Replays a recorded trace instead of the synthetic workload.
+    std::string tracePath;
+    double replaySpeed = 1.0;
+
+    // Records the first run into a trace.
+    std::string recordPath;
+};
+
+struct benchResult_t
+{
+    unsigned int numChannels;
+
+    double seconds;
+    size_t numLoaded;
+    size_t numFailed;
+
+    unsigned long long latency50;   // microseconds from Request until the ticket completed.
+    unsigned long long latency99;
+
+    size_t peakMemory;
+    size_t peakBufferMemory;
+
+    size_t numRawCacheHits;
+
+    StreamingTypeStats modelStats;
+};
+
+static benchResult_t RunBenchmark( const benchConfig_t& config, unsigned int numChannels, const char *recordPath )
+{
+    const ident_t modelBase = 0;
+    const ident_t txdBase = (ident_t)config.numModels;
+
+    // Every run sees the same resources.
+    std::mt19937 rng( config.seed );
+
+    std::uniform_real_distribution <double> sizeDist( log( (double)config.minDataSize ), log( (double)config.maxDataSize ) );
+
+    std::vector <std::unique_ptr <BenchLocation>> locations;
+
+    BenchType models( (ident_t)config.numModels );
+    BenchType texDicts( (ident_t)config.numTexDicts );
+
+    for ( unsigned int n = 0; n < config.numModels + config.numTexDicts; n++ )
+    {
+        size_t dataSize = (size_t)exp( sizeDist( rng ) );
+
+        unsigned long long readTime = config.readLatency + (unsigned long long)( (double)dataSize / config.readBandwidth );
+        unsigned long long decodeTime = (unsigned long long)( config.decodeCost * (double)dataSize / 1024.0 );
+
+        size_t residentSize = (size_t)( (double)dataSize * config.memoryInflation );
+
+        if ( n < config.numModels )
+        {
+            models.SetCost( (ident_t)n, decodeTime, residentSize );
+        }
+        else
+        {
+            texDicts.SetCost( (ident_t)( n - config.numModels ), decodeTime, residentSize );
+        }
+
+        locations.emplace_back( new BenchLocation( dataSize, readTime ) );
+    }
+
+    StreamMan manager( numChannels, config.numIOWorkers );
+
+    manager.SetMaxMemory( config.maxMemory );
+    manager.SetRawCacheMemory( config.rawCacheMemory, config.isRawCacheCompressed );
+
+    manager.RegisterResourceType( modelBase, (ident_t)config.numModels, &models );
+    manager.RegisterResourceType( txdBase, (ident_t)config.numTexDicts, &texDicts );
+
+    for ( unsigned int n = 0; n < config.numModels + config.numTexDicts; n++ )
+    {
+        manager.LinkResource( (ident_t)n, "bench" + std::to_string( n ), locations[ n ].get() );
+    }
+
+    if ( config.numTexDicts != 0 )
+    {
+        std::uniform_int_distribution <unsigned int> txdDist( 0, config.numTexDicts - 1 );
+
+        for ( unsigned int n = 0; n < config.numModels; n++ )
+        {
+            for ( unsigned int dep = 0; dep < config.dependenciesPerModel; dep++ )
+            {
+                // Duplicates are refused by the streaming system, that is fine.
+                manager.AddResourceDependency( modelBase + (ident_t)n, txdBase + (ident_t)txdDist( rng ) );
+            }
+        }
+    }
+
+    std::ofstream traceFile;
+
+    if ( recordPath != NULL )
+    {
+        traceFile.open( recordPath, std::ios::binary | std::ios::trunc );
+
+        manager.StartTrace(
+            [&]( const void *data, size_t dataSize )
+            {
+                traceFile.write( (const char*)data, dataSize );
+            }
+        );
+    }
+
+    // Request the models in random order with random distances to the camera.
+    // Further passes go back and forth over the same models.
+    std::vector <ident_t> requestOrder( config.numModels );
+
+    std::iota( requestOrder.begin(), requestOrder.end(), modelBase );
+    std::shuffle( requestOrder.begin(), requestOrder.end(), rng );
+
+    for ( unsigned int pass = 1; pass < config.numPasses; pass++ )
+    {
+        requestOrder.insert( requestOrder.end(), requestOrder.rbegin(), requestOrder.rbegin() + config.numModels );
+    }
+
+    std::uniform_real_distribution <float> priorityDist( 0.0f, 1000.0f );
+
+    std::vector <unsigned long long> requestTimes( requestOrder.size(), 0 );
+    std::vector <unsigned long long> latencies( requestOrder.size(), 0 );
+    std::vector <ticket_t> tickets;
+
+    std::atomic <size_t> numCompleted( 0 );
+    std::atomic <size_t> numFailed( 0 );
+
+    benchResult_t result;
+    result.numChannels = numChannels;
+    result.peakMemory = 0;
+    result.peakBufferMemory = 0;
+
+    auto samplePeaks = [&]( void )
+    {
+        StreamingStats stats;
+        manager.GetStatistics( stats );
+
+        result.peakMemory = std::max( result.peakMemory, stats.memoryInUse );
+        result.peakBufferMemory = std::max( result.peakBufferMemory, stats.bufferMemoryInUse );
+    };
+
+    const size_t requestsPerFrame = ( config.requestsPerFrame != 0 ? config.requestsPerFrame : requestOrder.size() );
+
+    const unsigned long long startTime = GetBenchTime();
+
+    size_t numRequested = 0;
+
+    while ( numRequested < requestOrder.size() )
+    {
+        // The next pass only starts once the camera has seen everything of the last one.
+        if ( numRequested != 0 && ( numRequested % config.numModels ) == 0 )
+        {
+            while ( numCompleted < numRequested )
+            {
+                samplePeaks();
+
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+            }
+        }
+
+        const unsigned long long frameStartTime = GetBenchTime();
+
+        const size_t passEnd = ( ( numRequested / config.numModels ) + 1 ) * config.numModels;
+
+        for ( size_t n = 0; n < requestsPerFrame && numRequested < passEnd; n++, numRequested++ )
+        {
+            const ident_t id = requestOrder[ numRequested ];
+
+            const size_t requestIndex = numRequested;
+
+            ticket_t ticket;
+
+            requestTimes[ requestIndex ] = GetBenchTime();
+
+            if ( manager.Request( id, priorityDist( rng ), &ticket ) == false )
+            {
+                numFailed++;
+                numCompleted++;
+                continue;
+            }
+
+            ticket->OnCompletion(
+                [&, requestIndex]( ident_t resID, bool hasSucceeded )
+                {
+                    latencies[ requestIndex ] = GetBenchTime() - requestTimes[ requestIndex ];
+
+                    if ( !hasSucceeded )
+                    {
+                        numFailed++;
+                    }
+
+                    numCompleted++;
+                }
+            );
+
+            tickets.push_back( std::move( ticket ) );
+        }
+
+        samplePeaks();
+
+        // Like a game running at 60 frames per second.
+        if ( config.requestsPerFrame != 0 )
+        {
+            std::this_thread::sleep_until(
+                std::chrono::steady_clock::now() + std::chrono::microseconds( 16667 ) - std::chrono::microseconds( GetBenchTime() - frameStartTime )
+            );
+        }
+    }
+
+    while ( numCompleted < requestOrder.size() )
+    {
+        samplePeaks();
+
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+
+    const unsigned long long endTime = GetBenchTime();
+
+    // The callbacks must have finished before we look at the latencies.
+    for ( const ticket_t& ticket : tickets )
+    {
+        ticket->Wait();
+    }
+
+    manager.LoadingBarrier();
+
+    manager.StopTrace();
+
+    samplePeaks();
+
+    manager.GetTypeStatistics( modelBase, result.modelStats );
+
+    {
+        StreamingStats stats;
+        manager.GetStatistics( stats );
+
+        result.numRawCacheHits = stats.numRawCacheHits;
+    }
+
+    result.seconds = (double)( endTime - startTime ) / 1000000.0;
+    result.numFailed = numFailed;
+    result.numLoaded = requestOrder.size() - result.numFailed;
+
+    std::sort( latencies.begin(), latencies.end() );
+
+    result.latency50 = ( latencies.empty() ? 0 : latencies[ latencies.size() / 2 ] );
+    result.latency99 = ( latencies.empty() ? 0 : latencies[ ( latencies.size() * 99 ) / 100 ] );
+
+    for ( unsigned int n = 0; n < config.numModels + config.numTexDicts; n++ )
+    {
+        manager.UnlinkResource( (ident_t)n );
+    }
+
+    manager.UnregisterResourceType( modelBase );
+    manager.UnregisterResourceType( txdBase );
+
+    return result;
+}
+
+static void PrintUsage( const char *programName )
+{
+    printf(
+        "usage: %s [options]\n"
+        "  --models <n>             models to request (%u)\n"
+        "  --txds <n>               texture dictionaries the models depend on (%u)\n"
+        "  --deps <n>               dependencies per model (%u)\n"
+        "  --min-size <KB>          smallest resource (%zu)\n"
+        "  --max-size <KB>          biggest resource (%zu)\n"
+        "  --read-latency <us>      time for every read (%u)\n"
+        "  --bandwidth <MB/s>       read bandwidth (%.0f)\n"
+        "  --decode <us/KB>         decode cost (%.1f)\n"
+        "  --inflation <factor>     resident memory compared to the data size (%.1f)\n"
+        "  --memory <MB>            streaming memory budget (%zu)\n"
+        "  --raw-cache <MB>         memory for keeping the data of resources, zero disables it (%zu)\n"
+        "  --compress <0|1>         compress the data in the raw cache (%d)\n"
+        "  --io-workers <n>         read-ahead threads (%u)\n"
+        "  --per-frame <n>          requests per 60Hz frame, zero requests everything at once (%u)\n"
+        "  --passes <n>             request all models this many times, going back and forth (%u)\n"
+        "  --channels <n,n,...>     channel counts to compare (1,2,4,8)\n"
+        "  --seed <n>               random seed (%u)\n"
+        "  --record <trace>         record the run with the first channel count\n"
+        "  --replay <trace>         replay a recorded streaming trace instead\n"
+        "  --speed <factor>         replay speed, zero replays as fast as possible (%.1f)\n",
+        programName,
+        benchConfig_t().numModels, benchConfig_t().numTexDicts, benchConfig_t().dependenciesPerModel,
+        benchConfig_t().minDataSize / 1024, benchConfig_t().maxDataSize / 1024,
+        benchConfig_t().readLatency, benchConfig_t().readBandwidth, benchConfig_t().decodeCost, benchConfig_t().memoryInflation,
+        benchConfig_t().maxMemory / ( 1024 * 1024 ), benchConfig_t().rawCacheMemory / ( 1024 * 1024 ), (int)benchConfig_t().isRawCacheCompressed,
+        benchConfig_t().numIOWorkers, benchConfig_t().requestsPerFrame, benchConfig_t().numPasses,
+        benchConfig_t().seed, benchConfig_t().replaySpeed
+    );
+}
+
+static bool ParseArguments( int argc, char *argv[], benchConfig_t& config )
+{
+    for ( int n = 1; n < argc; n++ )
+    {
+        std::string arg = argv[ n ];
+
+        if ( n + 1 >= argc )
+            return false;
+
+        const char *value = argv[ ++n ];
+
+        if ( arg == "--models" )
+        {
+            config.numModels = (unsigned int)strtoul( value, NULL, 10 );
+        }
+        else if ( arg == "--txds" )
+        {
+            config.numTexDicts = (unsigned int)strtoul( value, NULL, 10 );
+        }
+        else if ( arg == "--deps" )
+        {
+            config.dependenciesPerModel = (unsigned int)strtoul( value, NULL, 10 );
+        }
+        else if ( arg == "--min-size" )
+        {
+            config.minDataSize = (size_t)strtoull( value, NULL, 10 ) * 1024;
+        }
+        else if ( arg == "--max-size" )
+        {
+            config.maxDataSize = (size_t)strtoull( value, NULL, 10 ) * 1024;
+        }
+        else if ( arg == "--read-latency" )
+        {
+            config.readLatency = (unsigned int)strtoul( value, NULL, 10 );
+        }
+        else if ( arg == "--bandwidth" )
+        {
+            config.readBandwidth = atof( value );
+        }
+        else if ( arg == "--decode" )
+        {
+            config.decodeCost = atof( value );
+        }
+        else if ( arg == "--inflation" )
+        {
+            config.memoryInflation = atof( value );
+        }
+        else if ( arg == "--memory" )
+        {
+            config.maxMemory = (size_t)strtoull( value, NULL, 10 ) * 1024 * 1024;
+        }
+        else if ( arg == "--raw-cache" )
+        {
+            config.rawCacheMemory = (size_t)strtoull( value, NULL, 10 ) * 1024 * 1024;
+        }
+        else if ( arg == "--compress" )
+        {
+            config.isRawCacheCompressed = ( atoi( value ) != 0 );
+        }
+        else if ( arg == "--io-workers" )
+        {
+            config.numIOWorkers = (unsigned int)strtoul( value, NULL, 10 );
+        }
+        else if ( arg == "--per-frame" )
+        {
+            config.requestsPerFrame = (unsigned int)strtoul( value, NULL, 10 );
+        }
+        else if ( arg == "--passes" )
+        {
+            config.numPasses = (unsigned int)strtoul( value, NULL, 10 );
+        }
+        else if ( arg == "--channels" )
+        {
+            config.channelCounts.clear();
+
+            for ( const char *iter = value; *iter != '\0'; )
+            {
+                char *end;
+                unsigned long numChannels = strtoul( iter, &end, 10 );
+
+                if ( end == iter || numChannels == 0 )
+                    return false;
+
+                config.channelCounts.push_back( (unsigned int)numChannels );
+
+                iter = ( *end == ',' ? end + 1 : end );
+            }
+        }
+        else if ( arg == "--seed" )
+        {
+            config.seed = (unsigned int)strtoul( value, NULL, 10 );
+        }
+        else if ( arg == "--record" )
+        {
+            config.recordPath = value;
+        }
+        else if ( arg == "--replay" )
+        {
+            config.tracePath = value;
+        }
+        else if ( arg == "--speed" )
+        {
+            config.replaySpeed = atof( value );
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    // Sizes must make sense for the log-uniform distribution.
+    return ( config.minDataSize != 0 && config.minDataSize <= config.maxDataSize && config.readBandwidth > 0.0 && config.replaySpeed >= 0.0 && config.numPasses != 0 && !config.channelCounts.empty() );
+}
+
+static int BenchMain( int argc, char *argv[] )
+{
+    benchConfig_t config;
+
+    if ( !ParseArguments( argc, argv, config ) )
+    {
+        PrintUsage( argv[ 0 ] );
+        return 1;
+    }
+
+    if ( !config.tracePath.empty() )
+    {
+        return ReplayTrace( config.tracePath.c_str(), config.channelCounts, config.replaySpeed );
+    }
+
+    printf(
+        "%u models, %u txds, %u deps per model, %zu-%zu KB, %u us + %.0f MB/s reads, %.1f us/KB decode, %zu MB budget, %zu MB raw cache%s, %u io workers, %u passes\n\n",
+        config.numModels, config.numTexDicts, config.dependenciesPerModel,
+        config.minDataSize / 1024, config.maxDataSize / 1024,
+        config.readLatency, config.readBandwidth, config.decodeCost,
+        config.maxMemory / ( 1024 * 1024 ), config.rawCacheMemory / ( 1024 * 1024 ), ( config.isRawCacheCompressed ? " (compressed)" : "" ),
+        config.numIOWorkers, config.numPasses
+    );
+
+    printf( "channels    loads/s   p50 ms   p99 ms   peak MB   buffers MB   io p99 ms   decode p99 ms   cache hits   failed\n" );
+
+    for ( unsigned int numChannels : config.channelCounts )
+    {
+        const bool isFirstRun = ( numChannels == config.channelCounts[ 0 ] );
+
+        benchResult_t result = RunBenchmark( config, numChannels, ( isFirstRun && !config.recordPath.empty() ) ? config.recordPath.c_str() : NULL );
+
+        // As seen by the streaming system itself.
+        unsigned long long ioLatency99 = result.modelStats.ioTime.GetPercentile( 0.99 );
+        unsigned long long decodeLatency99 = result.modelStats.decodeTime.GetPercentile( 0.99 );
+
+        printf( "%8u %10.0f %8.2f %8.2f %9.1f %12.1f %11.2f %15.2f %12zu %8zu\n",
+            result.numChannels,
+            ( result.seconds > 0.0 ? (double)result.numLoaded / result.seconds : 0.0 ),
+            (double)result.latency50 / 1000.0,
+            (double)result.latency99 / 1000.0,
+            (double)result.peakMemory / ( 1024.0 * 1024.0 ),
+            (double)result.peakBufferMemory / ( 1024.0 * 1024.0 ),
+            (double)ioLatency99 / 1000.0,
+            (double)decodeLatency99 / 1000.0,
+            result.numRawCacheHits,
+            result.numFailed
+        );
+    }
+
+    return 0;
+}
+
+}
+}
+}
+
+int main( int argc, char *argv[] )
+{
+    return krt::streaming::bench::BenchMain( argc, argv );
+}
@@ -0,0 +1,433 @@
+#include "StdInc.h"
+#include "StreamingBench.h"
+
+#include <cstdio>
+#include <fstream>
+#include <unordered_set>
+
+// Replay of recorded streaming traces.
+// Every resource is replaced by a synthetic one that costs what the recorded loads did,
+// so that scheduling and eviction policies can be compared on the same session without the game.
+
+namespace krt
+{
+namespace streaming
+{
+namespace bench
+{
+
+typedef StreamingTraceRecord::eType traceEvent_t;
+
+// What the trace tells about a resource.
+struct replayCost_t
+{
+    size_t dataSize = 0;
+    unsigned long long ioTime = 0;
+    unsigned long long decodeTime = 0;
+    size_t residentSize = 0;
+    bool hasLoaded = false;
+};
+
+struct replayResult_t
+{
+    unsigned int numChannels;
+
+    double seconds;
+    size_t numLoads;
+
+    unsigned long long latency50;   // microseconds from Request until the resource had loaded.
+    unsigned long long latency99;
+
+    size_t peakMemory;
+
+    // Status queries of the runtime that did not find the resource loaded (pop-in).
+    size_t numQueries;
+    size_t numMisses;
+};
+
+static bool ReadTrace( const char *tracePath, std::vector <StreamingTraceRecord>& recordsOut )
+{
+    std::ifstream traceFile( tracePath, std::ios::binary );
+
+    if ( !traceFile )
+        return false;
+
+    StreamingTraceRecord record;
+
+    while ( traceFile.read( (char*)&record, sizeof( record ) ) )
+    {
+        recordsOut.push_back( record );
+    }
+
+    return ( !recordsOut.empty() && recordsOut[ 0 ].type == traceEvent_t::BEGIN && recordsOut[ 0 ].args[ 0 ] == StreamingTraceRecord::VERSION );
+}
+
+// Records that describe the state of the streaming system when the trace was started.
+static bool IsSetupRecord( traceEvent_t type )
+{
+    return ( type == traceEvent_t::SET_MAX_MEMORY || type == traceEvent_t::REGISTER_TYPE || type == traceEvent_t::LINK ||
+             type == traceEvent_t::ADD_DEPENDENCY || type == traceEvent_t::RESIDENT );
+}
+
+static void GatherCosts( const std::vector <StreamingTraceRecord>& records, std::unordered_map <ident_t, replayCost_t>& costsOut )
+{
+    for ( const StreamingTraceRecord& record : records )
+    {
+        if ( record.type == traceEvent_t::LINK )
+        {
+            costsOut[ record.id ].dataSize = record.args[ 0 ];
+        }
+        else if ( record.type == traceEvent_t::LOADED )
+        {
+            replayCost_t& cost = costsOut[ record.id ];
+
+            cost.ioTime = record.args[ 1 ];
+            cost.decodeTime = record.args[ 2 ];
+            cost.residentSize = record.args[ 3 ];
+            cost.hasLoaded = true;
+        }
+    }
+
+    // Resources that never loaded while recording cost what the others did on average.
+    double totalDataSize = 0.0;
+    double totalIOTime = 0.0;
+    double totalDecodeTime = 0.0;
+    double totalResidentSize = 0.0;
+
+    for ( const auto& pair : costsOut )
+    {
+        const replayCost_t& cost = pair.second;
+
+        if ( cost.hasLoaded )
+        {
+            totalDataSize += (double)cost.dataSize;
+            totalIOTime += (double)cost.ioTime;
+            totalDecodeTime += (double)cost.decodeTime;
+            totalResidentSize += (double)cost.residentSize;
+        }
+    }
+
+    if ( totalDataSize == 0.0 )
+        return;
+
+    for ( auto& pair : costsOut )
+    {
+        replayCost_t& cost = pair.second;
+
+        if ( !cost.hasLoaded )
+        {
+            double dataSize = (double)cost.dataSize;
+
+            cost.ioTime = (unsigned long long)( dataSize * totalIOTime / totalDataSize );
+            cost.decodeTime = (unsigned long long)( dataSize * totalDecodeTime / totalDataSize );
+            cost.residentSize = (size_t)( dataSize * totalResidentSize / totalDataSize );
+        }
+    }
+}
+
+static replayResult_t RunReplay( const std::vector <StreamingTraceRecord>& records, const std::unordered_map <ident_t, replayCost_t>& costs, unsigned int numChannels, double speed )
+{
+    // Have to outlive the manager.
+    std::vector <std::unique_ptr <BenchType>> types;
+    std::vector <std::unique_ptr <BenchLocation>> locations;
+
+    StreamMan manager( numChannels, records[ 0 ].args[ 2 ] );
+
+    auto getCost = [&]( ident_t id )
+    {
+        auto findIter = costs.find( id );
+
+        return ( findIter != costs.end() ? findIter->second : replayCost_t() );
+    };
+
+    auto getNumLoads = [&]( void )
+    {
+        size_t numLoads = 0;
+
+        for ( const std::unique_ptr <BenchType>& type : types )
+        {
+            numLoads += type->GetNumLoads();
+        }
+
+        return numLoads;
+    };
+
+    // Only requests that really had to load are measured, once per resource.
+    std::mutex lockLatencies;
+    std::vector <unsigned long long> latencies;     // must be ACCESSED UNDER lockLatencies !
+    std::unordered_set <ident_t> pendingIDs;        // must be ACCESSED UNDER lockLatencies !
+
+    std::vector <ticket_t> tickets;
+
+    replayResult_t result;
+    result.numChannels = numChannels;
+    result.peakMemory = 0;
+    result.numQueries = 0;
+    result.numMisses = 0;
+
+    unsigned long long lastSampleTime = 0;
+
+    auto samplePeaks = [&]( void )
+    {
+        lastSampleTime = GetBenchTime();
+
+        StreamingStats stats;
+        manager.GetStatistics( stats );
+
+        result.peakMemory = std::max( result.peakMemory, stats.memoryInUse );
+    };
+
+    // The state at the start of the trace is set up before the clock starts.
+    size_t firstLiveRecord = 1;
+
+    while ( firstLiveRecord < records.size() && IsSetupRecord( records[ firstLiveRecord ].type ) )
+    {
+        firstLiveRecord++;
+    }
+
+    unsigned long long startTime = 0;
+    unsigned long long traceStartTime = 0;
+    size_t numSetupLoads = 0;
+
+    for ( size_t n = 1; n <= records.size(); n++ )
+    {
+        if ( n == firstLiveRecord )
+        {
+            manager.LoadingBarrier();
+            manager.ResetStatistics();
+
+            numSetupLoads = getNumLoads();
+
+            startTime = GetBenchTime();
+            traceStartTime = ( n < records.size() ? records[ n ].time : 0 );
+        }
+
+        if ( n == records.size() )
+            break;
+
+        const StreamingTraceRecord& record = records[ n ];
+
+        // Keep the pace of the recording.
+        if ( n >= firstLiveRecord && speed > 0.0 )
+        {
+            unsigned long long dueTime = startTime + (unsigned long long)( (double)( record.time - traceStartTime ) / speed );
+            unsigned long long curTime = GetBenchTime();
+
+            if ( dueTime > curTime )
+            {
+                std::this_thread::sleep_for( std::chrono::microseconds( dueTime - curTime ) );
+            }
+        }
+
+        switch ( record.type )
+        {
+        case traceEvent_t::SET_MAX_MEMORY:
+            manager.SetMaxMemory( (size_t)( (unsigned long long)record.args[ 0 ] | ( (unsigned long long)record.args[ 1 ] << 32 ) ) );
+            break;
+        case traceEvent_t::REGISTER_TYPE:
+        {
+            ident_t range = (ident_t)record.args[ 0 ];
+
+            BenchType *type = new BenchType( range );
+
+            for ( ident_t localID = 0; localID < range; localID++ )
+            {
+                replayCost_t cost = getCost( record.id + localID );
+
+                type->SetCost( localID, cost.decodeTime, cost.residentSize );
+            }
+
+            types.emplace_back( type );
+
+            manager.RegisterResourceType( record.id, range, type );
+            break;
+        }
+        case traceEvent_t::UNREGISTER_TYPE:
+            manager.UnregisterResourceType( record.id );
+            break;
+        case traceEvent_t::LINK:
+        {
+            BenchLocation *location = new BenchLocation( record.args[ 0 ], getCost( record.id ).ioTime );
+
+            locations.emplace_back( location );
+
+            manager.LinkResource( record.id, "replay" + std::to_string( record.id ), location );
+            break;
+        }
+        case traceEvent_t::UNLINK:
+            manager.UnlinkResource( record.id );
+            break;
+        case traceEvent_t::ADD_DEPENDENCY:
+            manager.AddResourceDependency( record.id, (ident_t)record.args[ 0 ] );
+            break;
+        case traceEvent_t::REMOVE_DEPENDENCY:
+            manager.RemoveResourceDependency( record.id, (ident_t)record.args[ 0 ] );
+            break;
+        case traceEvent_t::RESIDENT:
+            manager.Request( record.id );
+            break;
+        case traceEvent_t::REQUEST:
+        {
+            float priority;
+            memcpy( &priority, &record.args[ 0 ], sizeof( priority ) );
+
+            bool isMeasured;
+            {
+                std::unique_lock <std::mutex> ctxPending( lockLatencies );
+
+                isMeasured = pendingIDs.insert( record.id ).second;
+            }
+
+            if ( !isMeasured )
+            {
+                manager.Request( record.id, priority );
+                break;
+            }
+
+            const unsigned long long requestTime = GetBenchTime();
+
+            ticket_t ticket;
+
+            if ( manager.Request( record.id, priority, &ticket ) == false || ticket->IsDone() )
+            {
+                // Nothing had to be loaded.
+                std::unique_lock <std::mutex> ctxPending( lockLatencies );
+
+                pendingIDs.erase( record.id );
+                break;
+            }
+
+            ticket->OnCompletion(
+                [&, requestTime]( ident_t id, bool hasSucceeded )
+                {
+                    unsigned long long latency = ( GetBenchTime() - requestTime );
+
+                    std::unique_lock <std::mutex> ctxPending( lockLatencies );
+
+                    pendingIDs.erase( id );
+
+                    if ( hasSucceeded )
+                    {
+                        latencies.push_back( latency );
+                    }
+                }
+            );
+
+            tickets.push_back( std::move( ticket ) );
+            break;
+        }
+        case traceEvent_t::UNLOAD:
+            manager.Unload( record.id );
+            break;
+        case traceEvent_t::CANCEL:
+            manager.CancelRequest( record.id );
+            break;
+        case traceEvent_t::QUERY_STATUS:
+            result.numQueries++;
+
+            if ( manager.GetResourceStatus( record.id ) != StreamMan::eResourceStatus::LOADED )
+            {
+                result.numMisses++;
+            }
+            break;
+        case traceEvent_t::LOADING_BARRIER:
+            manager.LoadingBarrier();
+            break;
+        default:
+            // Outcomes of the recorded session, we make our own.
+            break;
+        }
+
+        if ( GetBenchTime() - lastSampleTime >= 1000 )
+        {
+            samplePeaks();
+        }
+    }
+
+    manager.LoadingBarrier();
+
+    const unsigned long long endTime = GetBenchTime();
+
+    // The callbacks must have finished before we look at the latencies.
+    for ( const ticket_t& ticket : tickets )
+    {
+        ticket->Wait();
+    }
+
+    samplePeaks();
+
+    result.seconds = (double)( endTime - startTime ) / 1000000.0;
+    result.numLoads = ( getNumLoads() - numSetupLoads );
+
+    std::sort( latencies.begin(), latencies.end() );
+
+    result.latency50 = ( latencies.empty() ? 0 : latencies[ latencies.size() / 2 ] );
+    result.latency99 = ( latencies.empty() ? 0 : latencies[ ( latencies.size() * 99 ) / 100 ] );
+
+    return result;
+}
+
+int ReplayTrace( const char *tracePath, const std::vector <unsigned int>& channelCounts, double speed )
+{
+    std::vector <StreamingTraceRecord> records;
+
+    if ( !ReadTrace( tracePath, records ) )
+    {
+        printf( "could not read streaming trace %s\n", tracePath );
+        return 1;
+    }
+
+    std::unordered_map <ident_t, replayCost_t> costs;
+
+    GatherCosts( records, costs );
+
+    // How the recorded session did, to compare against.
+    size_t numRecordedLoads = 0;
+    size_t numRecordedQueries = 0;
+    size_t numRecordedMisses = 0;
+
+    for ( const StreamingTraceRecord& record : records )
+    {
+        if ( record.type == traceEvent_t::LOADED )
+        {
+            numRecordedLoads++;
+        }
+        else if ( record.type == traceEvent_t::QUERY_STATUS )
+        {
+            numRecordedQueries++;
+
+            if ( (StreamMan::eResourceStatus)record.args[ 0 ] != StreamMan::eResourceStatus::LOADED )
+            {
+                numRecordedMisses++;
+            }
+        }
+    }
+
+    printf(
+        "%zu records over %.1f s, recorded with %u channels: %zu loads, %.2f%% of %zu status queries missed\n\n",
+        records.size(), (double)records.back().time / 1000000.0, records[ 0 ].args[ 1 ],
+        numRecordedLoads, ( numRecordedQueries != 0 ? ( 100.0 * numRecordedMisses ) / numRecordedQueries : 0.0 ), numRecordedQueries
+    );
+
+    printf( "channels    loads/s   p50 ms   p99 ms   peak MB   missed %%\n" );
+
+    for ( unsigned int numChannels : channelCounts )
+    {
+        replayResult_t result = RunReplay( records, costs, numChannels, speed );
+
+        printf( "%8u %10.0f %8.2f %8.2f %9.1f %10.2f\n",
+            result.numChannels,
+            ( result.seconds > 0.0 ? (double)result.numLoads / result.seconds : 0.0 ),
+            (double)result.latency50 / 1000.0,
+            (double)result.latency99 / 1000.0,
+            (double)result.peakMemory / ( 1024.0 * 1024.0 ),
+            ( result.numQueries != 0 ? ( 100.0 * result.numMisses ) / result.numQueries : 0.0 )
+        );
+    }
+
+    return 0;
+}
+
+}
+}
+}
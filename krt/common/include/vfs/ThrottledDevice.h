@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vfs/Device.h>
+
+#include <random>
+
+namespace krt
+{
+namespace vfs
+{
+// Disk model of the throttled device.
+struct ThrottleParameters
+{
+	// Paid by every read that does not continue where the last read has ended.
+	uint32_t seekLatency; // microseconds
+
+	// Zero does not limit the bandwidth.
+	uint64_t bytesPerSecond;
+
+	// A random amount up to this is added to every read.
+	uint32_t jitter; // microseconds
+
+	// Only one read at a time, like a drive with a single head.
+	bool isSingleHead;
+
+	inline ThrottleParameters()
+	    : seekLatency(0), bytesPerSecond(0), jitter(0), isSingleHead(true)
+	{
+	}
+};
+
+// Slows down the reads of another device to the speed of a slow disk (like a HDD or an optical drive),
+// so that pop-in and I/O ordering effects can be seen on a fast machine.
+// Mount it in front of the device to throttle, all calls are passed through.
+// Mapping is not, since reading mapped data would never see the throttling.
+class ThrottledDevice : public Device
+{
+  public:
+	ThrottledDevice(const DevicePtr& otherDevice, const ThrottleParameters& parameters);
+
+	virtual THandle Open(const std::string& fileName, bool readOnly) override;
+
+	virtual THandle OpenBulk(const std::string& fileName, uint64_t* ptr) override;
+
+	virtual THandle Create(const std::string& filename) override;
+
+	virtual size_t Read(THandle handle, void* outBuffer, size_t size) override;
+
+	virtual size_t ReadBulk(THandle handle, uint64_t ptr, void* outBuffer, size_t size) override;
+
+	virtual size_t Write(THandle handle, const void* buffer, size_t size) override;
+
+	virtual size_t WriteBulk(THandle handle, uint64_t ptr, const void* buffer, size_t size) override;
+
+	virtual size_t Seek(THandle handle, intptr_t offset, int seekType) override;
+
+	virtual bool Close(THandle handle) override;
+
+	virtual bool CloseBulk(THandle handle) override;
+
+	virtual bool IsBulkSpaceShared() override;
+
+	virtual bool RemoveFile(const std::string& filename) override;
+
+	virtual bool RenameFile(const std::string& from, const std::string& to) override;
+
+	virtual bool CreateDirectory(const std::string& name) override;
+
+	virtual bool RemoveDirectory(const std::string& name) override;
+
+	virtual size_t GetLength(THandle handle) override;
+
+	virtual size_t GetLength(const std::string& fileName) override;
+
+	virtual THandle FindFirst(const std::string& folder, FindData* findData) override;
+
+	virtual bool FindNext(THandle handle, FindData* findData) override;
+
+	virtual void FindClose(THandle handle) override;
+
+	// Sets the path prefix for the device, which implementations should strip for generating a local path portion.
+	virtual void SetPathPrefix(const std::string& pathPrefix) override;
+
+  private:
+	// Reads through the other device and waits until the read took as long as it would on the modelled disk.
+	// Positions of reads that are not in a shared bulk space are only compared within the same handle.
+	template <typename TReadFunc>
+	size_t ThrottledRead(THandle handle, uint64_t position, size_t size, const TReadFunc& readFunc);
+
+	uint64_t GetReadDelay(THandle handle, uint64_t position, size_t size);
+
+  private:
+	DevicePtr m_otherDevice;
+
+	ThrottleParameters m_parameters;
+
+	// held during reads if there is only one head.
+	std::mutex m_headMutex;
+
+	std::mutex m_stateMutex;
+
+	// must be ACCESSED UNDER m_stateMutex !
+	std::mt19937 m_random;
+
+	THandle m_lastHandle;
+	uint64_t m_lastPosition;
+
+	std::map<THandle, uint64_t> m_readPositions; // for Read, as the other device keeps them to itself.
+};
+}
+}
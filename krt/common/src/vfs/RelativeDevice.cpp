@@ -42,6 +42,11 @@ size_t RelativeDevice::ReadBulk(THandle handle, uint64_t ptr, void* outBuffer, s
 	return m_otherDevice->ReadBulk(handle, ptr, outBuffer, size);
 }
 
+void RelativeDevice::ReadBulkAsync(THandle handle, uint64_t ptr, void* outBuffer, size_t size, const TReadCallback& callback)
+{
+	m_otherDevice->ReadBulkAsync(handle, ptr, outBuffer, size, callback);
+}
+
 size_t RelativeDevice::Write(THandle handle, const void* buffer, size_t size)
 {
 	return m_otherDevice->Write(handle, buffer, size);
@@ -67,6 +72,16 @@ bool RelativeDevice::CloseBulk(THandle handle)
 	return m_otherDevice->CloseBulk(handle);
 }
 
+const void* RelativeDevice::MapBulk(THandle handle, uint64_t ptr, size_t size)
+{
+	return m_otherDevice->MapBulk(handle, ptr, size);
+}
+
+void RelativeDevice::UnmapBulk(const void* view, size_t size)
+{
+	m_otherDevice->UnmapBulk(view, size);
+}
+
 bool RelativeDevice::RemoveFile(const std::string& filename)
 {
 	return m_otherDevice->RemoveFile(TranslatePath(filename));
@@ -0,0 +1,234 @@
+#include <StdInc.h>
+
+#include <vfs/ThrottledDevice.h>
+
+#include <chrono>
+
+namespace krt
+{
+namespace vfs
+{
+ThrottledDevice::ThrottledDevice(const DevicePtr& otherDevice, const ThrottleParameters& parameters)
+    : m_otherDevice(otherDevice), m_parameters(parameters), m_lastHandle(InvalidHandle), m_lastPosition(UINT64_MAX)
+{
+}
+
+uint64_t ThrottledDevice::GetReadDelay(THandle handle, uint64_t position, size_t size)
+{
+	std::lock_guard<std::mutex> lock(m_stateMutex);
+
+	uint64_t delay = 0;
+
+	if (handle != m_lastHandle || position != m_lastPosition)
+	{
+		delay += m_parameters.seekLatency;
+	}
+
+	if (m_parameters.bytesPerSecond != 0)
+	{
+		delay += (size * 1000000ULL) / m_parameters.bytesPerSecond;
+	}
+
+	if (m_parameters.jitter != 0)
+	{
+		delay += std::uniform_int_distribution<uint32_t>(0, m_parameters.jitter)(m_random);
+	}
+
+	m_lastHandle   = handle;
+	m_lastPosition = position + size;
+
+	return delay;
+}
+
+template <typename TReadFunc>
+size_t ThrottledDevice::ThrottledRead(THandle handle, uint64_t position, size_t size, const TReadFunc& readFunc)
+{
+	std::unique_lock<std::mutex> headLock(m_headMutex, std::defer_lock);
+
+	if (m_parameters.isSingleHead)
+	{
+		headLock.lock();
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	size_t didRead = readFunc();
+
+	// failed reads are not worth waiting for
+	if (didRead != -1)
+	{
+		std::this_thread::sleep_until(startTime + std::chrono::microseconds(GetReadDelay(handle, position, didRead)));
+	}
+
+	return didRead;
+}
+
+Device::THandle ThrottledDevice::Open(const std::string& fileName, bool readOnly)
+{
+	THandle handle = m_otherDevice->Open(fileName, readOnly);
+
+	if (handle != InvalidHandle)
+	{
+		std::lock_guard<std::mutex> lock(m_stateMutex);
+
+		m_readPositions[handle] = 0;
+	}
+
+	return handle;
+}
+
+Device::THandle ThrottledDevice::OpenBulk(const std::string& fileName, uint64_t* ptr)
+{
+	return m_otherDevice->OpenBulk(fileName, ptr);
+}
+
+Device::THandle ThrottledDevice::Create(const std::string& filename)
+{
+	THandle handle = m_otherDevice->Create(filename);
+
+	if (handle != InvalidHandle)
+	{
+		std::lock_guard<std::mutex> lock(m_stateMutex);
+
+		m_readPositions[handle] = 0;
+	}
+
+	return handle;
+}
+
+size_t ThrottledDevice::Read(THandle handle, void* outBuffer, size_t size)
+{
+	uint64_t position;
+
+	{
+		std::lock_guard<std::mutex> lock(m_stateMutex);
+
+		position = m_readPositions[handle];
+	}
+
+	size_t didRead = ThrottledRead(handle, position, size, [&]() {
+		return m_otherDevice->Read(handle, outBuffer, size);
+	});
+
+	if (didRead != -1)
+	{
+		std::lock_guard<std::mutex> lock(m_stateMutex);
+
+		m_readPositions[handle] = position + didRead;
+	}
+
+	return didRead;
+}
+
+size_t ThrottledDevice::ReadBulk(THandle handle, uint64_t ptr, void* outBuffer, size_t size)
+{
+	// all handles read from the same space, so switching between them does not cost anything
+	THandle spaceHandle = (m_otherDevice->IsBulkSpaceShared()) ? InvalidHandle : handle;
+
+	return ThrottledRead(spaceHandle, ptr, size, [&]() {
+		return m_otherDevice->ReadBulk(handle, ptr, outBuffer, size);
+	});
+}
+
+size_t ThrottledDevice::Write(THandle handle, const void* buffer, size_t size)
+{
+	return m_otherDevice->Write(handle, buffer, size);
+}
+
+size_t ThrottledDevice::WriteBulk(THandle handle, uint64_t ptr, const void* buffer, size_t size)
+{
+	return m_otherDevice->WriteBulk(handle, ptr, buffer, size);
+}
+
+size_t ThrottledDevice::Seek(THandle handle, intptr_t offset, int seekType)
+{
+	size_t position = m_otherDevice->Seek(handle, offset, seekType);
+
+	if (position != -1)
+	{
+		std::lock_guard<std::mutex> lock(m_stateMutex);
+
+		m_readPositions[handle] = position;
+	}
+
+	return position;
+}
+
+bool ThrottledDevice::Close(THandle handle)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_stateMutex);
+
+		m_readPositions.erase(handle);
+
+		// the handle value could be given out again
+		if (m_lastHandle == handle)
+		{
+			m_lastPosition = UINT64_MAX;
+		}
+	}
+
+	return m_otherDevice->Close(handle);
+}
+
+bool ThrottledDevice::CloseBulk(THandle handle)
+{
+	return m_otherDevice->CloseBulk(handle);
+}
+
+bool ThrottledDevice::IsBulkSpaceShared()
+{
+	return m_otherDevice->IsBulkSpaceShared();
+}
+
+bool ThrottledDevice::RemoveFile(const std::string& filename)
+{
+	return m_otherDevice->RemoveFile(filename);
+}
+
+bool ThrottledDevice::RenameFile(const std::string& from, const std::string& to)
+{
+	return m_otherDevice->RenameFile(from, to);
+}
+
+bool ThrottledDevice::CreateDirectory(const std::string& name)
+{
+	return m_otherDevice->CreateDirectory(name);
+}
+
+bool ThrottledDevice::RemoveDirectory(const std::string& name)
+{
+	return m_otherDevice->RemoveDirectory(name);
+}
+
+size_t ThrottledDevice::GetLength(THandle handle)
+{
+	return m_otherDevice->GetLength(handle);
+}
+
+size_t ThrottledDevice::GetLength(const std::string& fileName)
+{
+	return m_otherDevice->GetLength(fileName);
+}
+
+Device::THandle ThrottledDevice::FindFirst(const std::string& folder, FindData* findData)
+{
+	return m_otherDevice->FindFirst(folder, findData);
+}
+
+bool ThrottledDevice::FindNext(THandle handle, FindData* findData)
+{
+	return m_otherDevice->FindNext(handle, findData);
+}
+
+void ThrottledDevice::FindClose(THandle handle)
+{
+	return m_otherDevice->FindClose(handle);
+}
+
+void ThrottledDevice::SetPathPrefix(const std::string& pathPrefix)
+{
+	m_otherDevice->SetPathPrefix(pathPrefix);
+}
+}
+}
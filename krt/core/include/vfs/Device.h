@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+
 namespace krt
 {
 namespace vfs
@@ -20,6 +22,9 @@ public:
 
 	static const THandle InvalidHandle = -1;
 
+	// Called once an asynchronous read is done, with the amount of bytes read (-1 if the read failed).
+	typedef std::function<void(size_t)> TReadCallback;
+
 public:
 	virtual ~Device() = default;
 
@@ -33,6 +38,11 @@ public:
 
 	virtual size_t ReadBulk(THandle handle, uint64_t ptr, void* outBuffer, size_t size);
 
+	// Starts a bulk read without waiting for it, so that many reads can be in flight at once.
+	// The callback can be called on any thread, even before this returns. The buffer and the handle have to stay valid until then.
+	// Devices that cannot read asynchronously read right away and call back before returning.
+	virtual void ReadBulkAsync(THandle handle, uint64_t ptr, void* outBuffer, size_t size, const TReadCallback& callback);
+
 	virtual size_t Write(THandle handle, const void* buffer, size_t size);
 
 	virtual size_t WriteBulk(THandle handle, uint64_t ptr, const void* buffer, size_t size);
@@ -43,6 +53,17 @@ public:
 
 	virtual bool CloseBulk(THandle handle);
 
+	// Returns a read-only view of size bytes at the bulk pointer without reading them (like from a memory-mapped file),
+	// or nullptr if the device cannot do that, then the data has to be read with ReadBulk.
+	// The view stays valid until it is given back with UnmapBulk, even if the bulk handle is closed before.
+	virtual const void* MapBulk(THandle handle, uint64_t ptr, size_t size);
+
+	virtual void UnmapBulk(const void* view, size_t size);
+
+	// Returns true if the bulk pointers of all files on this device address one shared space (like an archive),
+	// so that any bulk handle of the device can read across file boundaries.
+	virtual bool IsBulkSpaceShared();
+
 	virtual bool RemoveFile(const std::string& filename);
 
 	virtual bool RenameFile(const std::string& from, const std::string& to);
@@ -3,6 +3,8 @@
 #include <vfs/Device.h>
 #include <vfs/Stream.h>
 
+#include <shared_mutex>
+
 namespace krt
 {
 namespace vfs
@@ -14,7 +16,9 @@ private:
 	{
 		std::string prefix;
 
-		mutable std::vector<DevicePtr> devices; // mutable? MUTABLE? is this Rust?!
+		uint32_t prefixHash;
+
+		std::vector<DevicePtr> devices;
 	};
 
 	// sorts mount points based on longest prefix
@@ -34,14 +38,48 @@ private:
 		}
 	};
 
+	// mount points are never changed in place - mounting builds a new table and swaps it in,
+	// so that paths can be resolved without taking m_mountMutex.
+	struct MountTable
+	{
+		// sorted by longest prefix first
+		std::vector<MountPoint> mounts;
+
+		// distinct prefix lengths, longest first
+		std::vector<size_t> prefixLengths;
+
+		// indices into mounts by the hash of their prefix
+		std::unordered_multimap<uint32_t, size_t> mountsByHash;
+
+		// devices that were found for paths on mount points with multiple devices (nullptr if no device has the file)
+		// this belongs to the table, so it is thrown away on every mount or unmount.
+		// split by path hash, so that threads resolving different paths do not share a lock.
+		struct ResolveStripe
+		{
+			std::unordered_map<std::string, DevicePtr> paths;
+
+			std::shared_timed_mutex mutex;
+		};
+
+		mutable ResolveStripe resolveStripes[16];
+	};
+
+	typedef std::shared_ptr<const MountTable> MountTablePtr;
+
 private:
-	std::set<MountPoint, MountPointComparator> m_mounts;
+	// only replaced under m_mountMutex, read with std::atomic_load
+	MountTablePtr m_mountTable;
 
 	std::recursive_mutex m_mountMutex;
 
 	// fallback device - usually a local file system implementation
 	DevicePtr m_fallbackDevice;
 
+private:
+	DevicePtr ResolveDevice(const MountTable& table, const MountPoint& mount, const std::string& path);
+
+	void SetMounts(std::vector<MountPoint> mounts);
+
 public:
 	Manager();
 
@@ -19,6 +19,8 @@ public:
 
 	virtual size_t ReadBulk(THandle handle, uint64_t ptr, void* outBuffer, size_t size) override;
 
+	virtual void ReadBulkAsync(THandle handle, uint64_t ptr, void* outBuffer, size_t size, const TReadCallback& callback) override;
+
 	virtual size_t Write(THandle handle, const void* buffer, size_t size) override;
 
 	virtual size_t WriteBulk(THandle handle, uint64_t ptr, const void* buffer, size_t size) override;
@@ -29,6 +31,10 @@ public:
 
 	virtual bool CloseBulk(THandle handle) override;
 
+	virtual const void* MapBulk(THandle handle, uint64_t ptr, size_t size) override;
+
+	virtual void UnmapBulk(const void* view, size_t size) override;
+
 	virtual bool RemoveFile(const std::string& filename) override;
 
 	virtual bool RenameFile(const std::string& from, const std::string& to) override;
@@ -20,6 +20,11 @@ size_t Device::ReadBulk(THandle handle, uint64_t ptr, void* outBuffer, size_t si
 	return INVALID_DEVICE_HANDLE;
 }
 
+void Device::ReadBulkAsync(THandle handle, uint64_t ptr, void* outBuffer, size_t size, const TReadCallback& callback)
+{
+	callback(ReadBulk(handle, ptr, outBuffer, size));
+}
+
 size_t Device::Write(THandle handle, const void* buffer, size_t size)
 {
 	return INVALID_DEVICE_HANDLE;
@@ -35,6 +40,20 @@ bool Device::CloseBulk(THandle handle)
 	return false;
 }
 
+const void* Device::MapBulk(THandle handle, uint64_t ptr, size_t size)
+{
+	return nullptr;
+}
+
+void Device::UnmapBulk(const void* view, size_t size)
+{
+}
+
+bool Device::IsBulkSpaceShared()
+{
+	return false;
+}
+
 bool Device::CreateDirectory(const std::string& name)
 {
 	return false;
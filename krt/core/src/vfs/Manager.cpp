@@ -7,9 +7,28 @@ namespace krt
 {
 namespace vfs
 {
+// paths that were resolved on mount points with multiple devices, per stripe, before the stripe is started over
+static const size_t MaxResolvedPaths = 1024;
+
+// FNV-1a
+static inline uint32_t HashPrefix(const char* prefix, size_t length)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= static_cast<uint8_t>(prefix[i]);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
 Manager::Manager()
 {
 	m_fallbackDevice = std::make_shared<Win32Device>();
+
+	m_mountTable = std::make_shared<MountTable>();
 }
 
 StreamPtr Manager::OpenRead(const std::string& path)
@@ -43,38 +62,35 @@ DevicePtr Manager::GetDevice(const std::string& path)
 		}
 	}
 
-	std::lock_guard<std::recursive_mutex> lock(m_mountMutex);
+	// hold on to the current table, mounting in the meantime does not affect us
+	MountTablePtr table = std::atomic_load(&m_mountTable);
 
 	// if only one device exists for a chosen prefix, we want to always return that device
 	// if multiple exists, we only want to return a device if there's a file/directory entry by the path we specify
 
-	for (const auto& mount : m_mounts)
+	for (size_t prefixLength : table->prefixLengths)
 	{
-		// if the prefix patches
-		if (strncmp(path.c_str(), mount.prefix.c_str(), mount.prefix.length()) == 0)
+		if (prefixLength > path.length())
 		{
-			// single device case
-			if (mount.devices.size() == 1)
-			{
-				return mount.devices[0];
-			}
-			else
-			{
-				// check each device assigned to the mount point
-				Device::THandle handle;
+			continue;
+		}
 
-				for (const auto& device : mount.devices)
-				{
-					if ((handle = device->Open(path, true)) != Device::InvalidHandle)
-					{
-						device->Close(handle);
+		auto range = table->mountsByHash.equal_range(HashPrefix(path.c_str(), prefixLength));
+
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			const auto& mount = table->mounts[it->second];
 
-						return device;
-					}
+			// if the prefix matches
+			if (mount.prefix.length() == prefixLength && memcmp(path.c_str(), mount.prefix.c_str(), prefixLength) == 0)
+			{
+				// single device case
+				if (mount.devices.size() == 1)
+				{
+					return mount.devices[0];
 				}
 
-				// as this is a valid mount, but no valid file, bail out with nothing
-				return nullptr;
+				return ResolveDevice(*table, mount, path);
 			}
 		}
 	}
@@ -82,6 +98,76 @@ DevicePtr Manager::GetDevice(const std::string& path)
 	return m_fallbackDevice;
 }
 
+DevicePtr Manager::ResolveDevice(const MountTable& table, const MountPoint& mount, const std::string& path)
+{
+	auto& stripe = table.resolveStripes[std::hash<std::string>()(path) % _countof(table.resolveStripes)];
+
+	// did we look for this path before?
+	{
+		shared_lock_acquire<std::shared_timed_mutex> ctxFindResolved(stripe.mutex);
+
+		auto it = stripe.paths.find(path);
+
+		if (it != stripe.paths.end())
+		{
+			return it->second;
+		}
+	}
+
+	// check each device assigned to the mount point
+	DevicePtr foundDevice;
+	Device::THandle handle;
+
+	for (const auto& device : mount.devices)
+	{
+		if ((handle = device->Open(path, true)) != Device::InvalidHandle)
+		{
+			device->Close(handle);
+
+			foundDevice = device;
+			break;
+		}
+	}
+
+	// if no device has the file, this is a valid mount but no valid file - that is remembered as well
+	{
+		exclusive_lock_acquire<std::shared_timed_mutex> ctxAddResolved(stripe.mutex);
+
+		if (stripe.paths.size() >= MaxResolvedPaths)
+		{
+			stripe.paths.clear();
+		}
+
+		stripe.paths[path] = foundDevice;
+	}
+
+	return foundDevice;
+}
+
+// only THREAD-SAFE if called from m_mountMutex.
+void Manager::SetMounts(std::vector<MountPoint> mounts)
+{
+	auto table = std::make_shared<MountTable>();
+
+	std::sort(mounts.begin(), mounts.end(), MountPointComparator());
+
+	for (size_t i = 0; i < mounts.size(); i++)
+	{
+		const auto& mount = mounts[i];
+
+		if (table->prefixLengths.empty() || table->prefixLengths.back() != mount.prefix.length())
+		{
+			table->prefixLengths.push_back(mount.prefix.length());
+		}
+
+		table->mountsByHash.insert({ mount.prefixHash, i });
+	}
+
+	table->mounts = std::move(mounts);
+
+	std::atomic_store(&m_mountTable, MountTablePtr(std::move(table)));
+}
+
 void Manager::Mount(const DevicePtr& device, const std::string& path)
 {
 	// set the path prefix on the device
@@ -90,44 +176,48 @@ void Manager::Mount(const DevicePtr& device, const std::string& path)
 	// mount
 	std::lock_guard<std::recursive_mutex> lock(m_mountMutex);
 
+	std::vector<MountPoint> mounts = std::atomic_load(&m_mountTable)->mounts;
+
 	// find an existing mount in the mount list to add to
-	for (auto&& mount : m_mounts)
+	bool foundMount = false;
+
+	for (auto&& mount : mounts)
 	{
 		if (mount.prefix == path)
 		{
 			mount.devices.push_back(device);
-			return;
+
+			foundMount = true;
+			break;
 		}
 	}
 
 	// if we're here, we didn't find any existing device - add a new one instead
+	if (!foundMount)
 	{
 		MountPoint mount;
-		mount.prefix = path;
+		mount.prefix     = path;
+		mount.prefixHash = HashPrefix(path.c_str(), path.length());
 		mount.devices.push_back(device);
 
-		m_mounts.insert(mount);
+		mounts.push_back(std::move(mount));
 	}
+
+	SetMounts(std::move(mounts));
 }
 
 void Manager::Unmount(const std::string& path)
 {
 	std::lock_guard<std::recursive_mutex> lock(m_mountMutex);
 
-	// we need to manually iterate to be able to use erase(iterator)
-	for (auto it = m_mounts.begin(); it != m_mounts.end(); )
+	std::vector<MountPoint> mounts = std::atomic_load(&m_mountTable)->mounts;
+
+	mounts.erase(std::remove_if(mounts.begin(), mounts.end(), [&](const MountPoint& mount)
 	{
-		const auto& mount = *it;
+		return (mount.prefix == path);
+	}), mounts.end());
 
-		if (mount.prefix == path)
-		{
-			it = m_mounts.erase(it);
-		}
-		else
-		{
-			++it;
-		}
-	}
+	SetMounts(std::move(mounts));
 }
 
 static Manager TheManager;
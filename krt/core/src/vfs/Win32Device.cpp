@@ -11,6 +11,41 @@ namespace krt
 {
 namespace vfs
 {
+// an asynchronous read that is in flight
+struct AsyncRead
+{
+	OVERLAPPED overlapped; // has to come first, the completion only gives us this
+	Device::TReadCallback callback;
+};
+
+static VOID CALLBACK OnReadCompleted(DWORD errorCode, DWORD bytesRead, LPOVERLAPPED overlapped)
+{
+	std::unique_ptr<AsyncRead> read(reinterpret_cast<AsyncRead*>(overlapped));
+
+	read->callback((errorCode == ERROR_SUCCESS) ? bytesRead : -1);
+}
+
+// event for waiting on synchronous bulk reads, kept per thread so that it does not have to be created for every read
+struct ReadEvent
+{
+	HANDLE hEvent;
+
+	inline ReadEvent()
+	    : hEvent(CreateEventW(nullptr, FALSE, FALSE, nullptr))
+	{
+	}
+
+	inline ~ReadEvent()
+	{
+		if (hEvent != nullptr)
+		{
+			CloseHandle(hEvent);
+		}
+	}
+};
+
+static thread_local ReadEvent g_readEvent;
+
 Device::THandle Win32Device::Open(const std::string& fileName, bool readOnly)
 {
 	std::wstring wideName = ToWide(fileName);
@@ -39,6 +74,15 @@ Device::THandle Win32Device::OpenBulk(const std::string& fileName, uint64_t* ptr
 	    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
 	    nullptr);
 
+	// asynchronous reads are completed by the system thread pool
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		if (!BindIoCompletionCallback(hFile, OnReadCompleted, 0))
+		{
+			assert(!"Could not bind the file to the I/O thread pool!");
+		}
+	}
+
 	return reinterpret_cast<THandle>(hFile);
 }
 
@@ -71,33 +115,30 @@ size_t Win32Device::ReadBulk(THandle handle, uint64_t ptr, void* outBuffer, size
 {
 	assert(handle != Device::InvalidHandle);
 
+	HANDLE hEvent = g_readEvent.hEvent;
+
+	if (hEvent == nullptr)
+	{
+		return -1;
+	}
+
 	OVERLAPPED overlapped = {};
 	overlapped.Offset     = (ptr & 0xFFFFFFFF);
 	overlapped.OffsetHigh = ptr >> 32;
 
-	BOOL result    = ReadFile(reinterpret_cast<HANDLE>(handle), outBuffer, static_cast<DWORD>(size), nullptr, &overlapped);
-	bool ioPending = false;
-
-	if (!result)
-	{
-		ioPending = (GetLastError() == ERROR_IO_PENDING);
+	// setting the low bit of the event keeps the completion from going to the thread pool, we wait for it ourselves
+	overlapped.hEvent = reinterpret_cast<HANDLE>(reinterpret_cast<uintptr_t>(hEvent) | 1);
 
-		if (!ioPending)
-		{
-			return -1;
-		}
-	}
+	BOOL result = ReadFile(reinterpret_cast<HANDLE>(handle), outBuffer, static_cast<DWORD>(size), nullptr, &overlapped);
 
-	// wait for the IO to complete in a polling fashion
-	// this should be safe enough as nobody expects IO to be time-critical
-	if (ioPending)
+	if (!result && GetLastError() != ERROR_IO_PENDING)
 	{
-		while (!HasOverlappedIoCompleted(&overlapped))
-		{
-			Sleep(5);
-		}
+		return -1;
 	}
 
+	// the event is signaled once the read is done, even if it was done right away
+	WaitForSingleObject(hEvent, INFINITE);
+
 	// get error result/bytes transferred the 'safe' way (one could also use Internal/InternalHigh, but despite
 	// being standardized those are scarcely documented)
 	DWORD bytesRead;
@@ -109,6 +150,27 @@ size_t Win32Device::ReadBulk(THandle handle, uint64_t ptr, void* outBuffer, size
 	return bytesRead;
 }
 
+void Win32Device::ReadBulkAsync(THandle handle, uint64_t ptr, void* outBuffer, size_t size, const TReadCallback& callback)
+{
+	assert(handle != Device::InvalidHandle);
+
+	AsyncRead* read = new AsyncRead();
+
+	read->overlapped.Offset     = (ptr & 0xFFFFFFFF);
+	read->overlapped.OffsetHigh = ptr >> 32;
+	read->callback              = callback;
+
+	BOOL result = ReadFile(reinterpret_cast<HANDLE>(handle), outBuffer, static_cast<DWORD>(size), nullptr, &read->overlapped);
+
+	// the completion is posted to the thread pool even if the read was done right away
+	if (!result && GetLastError() != ERROR_IO_PENDING)
+	{
+		delete read;
+
+		callback(-1);
+	}
+}
+
 size_t Win32Device::Write(THandle handle, const void* buffer, size_t size)
 {
 	assert(handle != Device::InvalidHandle);
@@ -158,6 +220,48 @@ bool Win32Device::CloseBulk(THandle handle)
 	return Close(handle);
 }
 
+const void* Win32Device::MapBulk(THandle handle, uint64_t ptr, size_t size)
+{
+	assert(handle != Device::InvalidHandle);
+
+	// views have to start at the allocation granularity
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+
+	uint64_t viewStart = ptr - (ptr % systemInfo.dwAllocationGranularity);
+	size_t viewOffset  = static_cast<size_t>(ptr - viewStart);
+
+	HANDLE hMapping = CreateFileMappingW(reinterpret_cast<HANDLE>(handle), nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (hMapping == nullptr)
+	{
+		return nullptr;
+	}
+
+	void* view = MapViewOfFile(hMapping, FILE_MAP_READ, static_cast<DWORD>(viewStart >> 32), static_cast<DWORD>(viewStart & 0xFFFFFFFF), viewOffset + size);
+
+	// the view keeps the mapping alive on its own
+	CloseHandle(hMapping);
+
+	if (view == nullptr)
+	{
+		return nullptr;
+	}
+
+	return static_cast<const char*>(view) + viewOffset;
+}
+
+void Win32Device::UnmapBulk(const void* view, size_t size)
+{
+	// views start at the allocation granularity, so the start can be found again
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+
+	uintptr_t viewAddress = reinterpret_cast<uintptr_t>(view);
+
+	UnmapViewOfFile(reinterpret_cast<void*>(viewAddress - (viewAddress % systemInfo.dwAllocationGranularity)));
+}
+
 bool Win32Device::RemoveFile(const std::string& filename)
 {
 	std::wstring wideName = ToWide(filename);
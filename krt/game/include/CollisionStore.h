@@ -33,7 +33,7 @@ public:
 			return m_models;
 		}
 
-		inline CollisionArchive(const vfs::DevicePtr& device, const std::string& pathToRes) : m_location(device, pathToRes)
+		inline CollisionArchive(const vfs::DevicePtr& device, const std::string& pathToRes) : m_memorySize(0), m_location(device, pathToRes)
 		{
 		}
 
@@ -47,6 +47,8 @@ public:
 
 		std::vector<std::unique_ptr<CollisionModel>> m_models;
 
+		size_t m_memorySize;
+
 		DeviceResourceLocation m_location;
 	};
 
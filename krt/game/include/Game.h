@@ -2,7 +2,11 @@
 
 // Game things go here!
 
-#define GAME_NUM_STREAMING_CHANNELS 4
+// Zero picks the channel count from the number of CPU cores.
+#define GAME_NUM_STREAMING_CHANNELS 0
+
+// Threads that read resources from disk while the channels parse them.
+#define GAME_NUM_STREAMING_IO_WORKERS 1
 
 #include "vfs\Device.h"
 
@@ -58,9 +62,17 @@ public:
 	void SetActiveCamera(Camera* theCamera) { this->activeCam = theCamera; }
 	Camera* GetActiveCamera(void) { return this->activeCam; }
 
+	// Writes a readable report of the streaming telemetry, line by line.
+	void WriteStreamingStats(const std::function<void(const std::string&)>& writeLine);
+
+	// Records the streaming requests into a file, for replaying them in the streaming benchmark.
+	bool StartStreamingTrace(const std::string& path);
+
 private:
 	void MountUserDirectory();
 
+	void DumpStreamingStatsIfNeeded(uint64_t thisTime);
+
 	void YieldThreadForShortTime();
 
 	void LoadUniverseIfAvailable();
@@ -88,6 +100,16 @@ private:
 
 	float timescale;
 
+	int streamingMemory; // in megabytes
+
+	int streamingRawCacheMemory; // in megabytes, zero does not keep the data of evicted resources
+	bool streamingRawCacheCompressed;
+
+	int streamingDestroyBudget; // in microseconds per frame
+
+	int streamingStatsInterval; // in seconds, zero does not dump the streaming telemetry
+	uint64_t lastStreamingStatsDump;
+
 	Camera worldCam; // camera to render the main world in
 
 	Camera* activeCam;
@@ -97,6 +119,16 @@ private:
 
 	std::unique_ptr<ConVar<float>> timescaleVariable;
 
+	std::unique_ptr<ConVar<int>> streamingMemoryVariable;
+
+	std::unique_ptr<ConVar<int>> streamingRawCacheMemoryVariable;
+
+	std::unique_ptr<ConVar<bool>> streamingRawCacheCompressedVariable;
+
+	std::unique_ptr<ConVar<int>> streamingDestroyBudgetVariable;
+
+	std::unique_ptr<ConVar<int>> streamingStatsIntervalVariable;
+
 	std::unique_ptr<ConVar<std::string>> gameVariable;
 
 	std::unique_ptr<ConVar<std::string>> gamePathVariable;
@@ -109,6 +109,7 @@ struct ModelManager : public streaming::StreamingTypeInterface
 		DeviceResourceLocation vfsResLoc;
 
 		rw::Object* modelPtr;
+		size_t memorySize; // resident size of modelPtr, estimated when it is loaded.
 
 		SRWLOCK_VIRTUAL lockModelLoading;
 	};
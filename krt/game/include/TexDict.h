@@ -53,6 +53,7 @@ private:
 		DeviceResourceLocation vfsResLoc;
 
 		rw::TexDictionary* txdPtr;
+		size_t memorySize; // resident size of all textures in txdPtr, estimated when it is loaded.
 
 		SRWLOCK_VIRTUAL lockResourceLoad;
 	};
@@ -54,5 +54,10 @@ private:
 	};
 
 	SectorGrid<StaticEntitySector, 3000, 3> staticEntityGrid;
+
+	// Models that were not loaded yet for visible entities, requested at once after the visibility pass.
+	// Kept across frames so that they do not have to be allocated every frame.
+	std::vector<streaming::ident_t> visibleModelRequests;
+	std::vector<float> visibleModelDistances;
 };
 };
\ No newline at end of file
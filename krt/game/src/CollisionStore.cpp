@@ -20,6 +20,22 @@ CollisionStore::CollisionStore(streaming::StreamMan& streaming) : m_streaming(st
 
 CollisionStore::~CollisionStore()
 {
+	// unload everything in one go, so that unlinking does not have to wait for every archive on its own
+	{
+		std::vector<streaming::ident_t> archiveIDs;
+
+		for (auto& entry : m_entries)
+		{
+			if (entry.get())
+			{
+				archiveIDs.push_back(entry->GetID());
+			}
+		}
+
+		m_streaming.Unload(archiveIDs.data(), archiveIDs.size());
+		m_streaming.LoadingBarrier();
+	}
+
 	// remove all entries
 	for (auto& entry : m_entries)
 	{
@@ -87,6 +103,8 @@ void CollisionStore::LoadResource(streaming::ident_t localID, const void* dataBu
 	vfs::StreamPtr stream = vfs::OpenRead(vfs::MakeMemoryFilename(dataBuf, memSize));
 
 	auto archive = m_entries[localID];
+
+	size_t memorySize = 0;
 	
 	while (true)
 	{
@@ -133,20 +151,40 @@ void CollisionStore::LoadResource(streaming::ident_t localID, const void* dataBu
 		}
 
 		archive->m_models.push_back(std::move(colModel));
+
+		// the collision arrays are read straight from the chunk, so they take about as much memory
+		memorySize += sizeof(CollisionModel) + sizeof(CColModel) + header.size;
 	}
+
+	archive->m_memorySize = memorySize;
 }
 
 void CollisionStore::UnloadResource(streaming::ident_t localID)
 {
 	std::shared_ptr<CollisionArchive> archive = m_entries[localID];
 
-	// this should dereference everything inside
+	// the models are dereferenced later, model infos only hold weak references to them
+	auto models = std::make_shared<std::vector<std::unique_ptr<CollisionModel>>>(std::move(archive->m_models));
+
 	archive->m_models.clear();
+
+	m_streaming.DeferDestruction([models]() {
+		models->clear();
+	}, archive->m_memorySize);
+
+	archive->m_memorySize = 0;
 }
 
 size_t CollisionStore::GetObjectMemorySize(streaming::ident_t localID) const
 {
-	return 1;
+	const std::shared_ptr<CollisionArchive>& archive = m_entries[localID];
+
+	if (!archive)
+	{
+		return 0;
+	}
+
+	return archive->m_memorySize;
 }
 
 ConsoleCommand loadCollCommand("load_coll", [] (const std::string& path)
@@ -155,8 +193,13 @@ ConsoleCommand loadCollCommand("load_coll", [] (const std::string& path)
 	
 	if (identifier != -1)
 	{
-		theGame->GetStreaming().Request(identifier);
-		theGame->GetStreaming().LoadingBarrier();
+		// only wait for this archive, not for everything else that is streaming
+		streaming::ticket_t ticket;
+
+		if (theGame->GetStreaming().Request(identifier, 0.0f, &ticket))
+		{
+			ticket->Wait();
+		}
 	}
 });
 }
\ No newline at end of file
@@ -30,7 +30,7 @@ namespace krt
 
 Game* theGame = NULL;
 
-Game::Game(const std::vector<std::pair<std::string, std::string>>& setList) : streaming(GAME_NUM_STREAMING_CHANNELS), texManager(streaming), modelManager(streaming, texManager), colStore(streaming)
+Game::Game(const std::vector<std::pair<std::string, std::string>>& setList) : streaming(GAME_NUM_STREAMING_CHANNELS, GAME_NUM_STREAMING_IO_WORKERS), texManager(streaming), modelManager(streaming, texManager), colStore(streaming)
 {
 	assert(theGame == NULL);
 
@@ -38,6 +38,26 @@ Game::Game(const std::vector<std::pair<std::string, std::string>>& setList) : st
 	maxFPSVariable    = std::make_unique<ConVar<int>>("maxFPS", ConVar_Archive, 60, &maxFPS);
 	timescaleVariable = std::make_unique<ConVar<float>>("timescale", ConVar_None, 1.0f, &timescale);
 
+	// Memory budget of the streaming system, so it can be sized per machine.
+	streamingMemoryVariable = std::make_unique<ConVar<int>>("streaming_memory", ConVar_Archive, 256, &streamingMemory);
+	streamingMemoryVariable->GetHelper()->SetConstraints(16, 16384);
+
+	// Raw data of evicted resources that is kept around, so that loading them again does not hit the disk.
+	streamingRawCacheMemoryVariable = std::make_unique<ConVar<int>>("streaming_raw_cache", ConVar_Archive, 64, &streamingRawCacheMemory);
+	streamingRawCacheMemoryVariable->GetHelper()->SetConstraints(0, 4096);
+
+	streamingRawCacheCompressedVariable = std::make_unique<ConVar<bool>>("streaming_raw_cache_compress", ConVar_Archive, false, &streamingRawCacheCompressed);
+
+	// Time per frame that is spent destroying unloaded objects, so that big unload waves do not cause hitches.
+	streamingDestroyBudgetVariable = std::make_unique<ConVar<int>>("streaming_destroy_budget", ConVar_Archive, 2000, &streamingDestroyBudget);
+	streamingDestroyBudgetVariable->GetHelper()->SetConstraints(100, 100000);
+
+	// Periodic dump of the streaming telemetry, to find out why things pop in.
+	streamingStatsIntervalVariable = std::make_unique<ConVar<int>>("streaming_stats_dump", ConVar_Archive, 0, &streamingStatsInterval);
+	streamingStatsIntervalVariable->GetHelper()->SetConstraints(0, 3600);
+
+	lastStreamingStatsDump = 0;
+
 	// Console variables for loading the default game universe.
 	gameVariable     = std::make_unique<ConVar<std::string>>("gameName", ConVar_Archive, "gta3");
 	gamePathVariable = std::make_unique<ConVar<std::string>>("gamePath", ConVar_Archive, "");
@@ -183,6 +203,15 @@ void Game::Run()
 		// try saving changed console variables
 		console::SaveConfigurationIfNeeded("user:/config.cfg");
 
+		// apply the streaming memory budget
+		this->streaming.SetMaxMemory((size_t)this->streamingMemory * 1024 * 1024);
+		this->streaming.SetRawCacheMemory((size_t)this->streamingRawCacheMemory * 1024 * 1024, this->streamingRawCacheCompressed);
+
+		// destroy unloaded objects, on this thread since the device objects belong to it
+		this->streaming.RunDeferredDestructions(this->streamingDestroyBudget);
+
+		DumpStreamingStatsIfNeeded(thisTime);
+
 		// load the game universe if variables are valid
 		LoadUniverseIfAvailable();
 
@@ -197,6 +226,192 @@ void Game::Run()
 	}
 }
 
+static std::string GetStreamingTypeName(streaming::ident_t base)
+{
+	if (base == MODEL_ID_BASE)
+	{
+		return "models";
+	}
+	else if (base == TXD_START_ID)
+	{
+		return "txds";
+	}
+
+	return "type at " + std::to_string(base);
+}
+
+void Game::WriteStreamingStats(const std::function<void(const std::string&)>& writeLine)
+{
+	streaming::StreamingStats stats;
+	this->streaming.GetStatistics(stats);
+
+	char line[256];
+
+	snprintf(line, sizeof(line), "memory: %zu / %zu KB, buffers %zu KB (%zu KB idle)",
+	         stats.memoryInUse / 1024, stats.maxMemory / 1024, stats.bufferMemoryInUse / 1024, stats.bufferMemoryIdle / 1024);
+	writeLine(line);
+
+	snprintf(line, sizeof(line), "raw cache: %zu / %zu KB (%zu KB uncompressed), %zu hits, %zu misses",
+	         stats.rawCacheMemoryInUse / 1024, stats.rawCacheMaxMemory / 1024, stats.rawCacheDataSize / 1024, stats.numRawCacheHits, stats.numRawCacheMisses);
+	writeLine(line);
+
+	snprintf(line, sizeof(line), "destruction: %zu pending (%zu KB)",
+	         stats.numPendingDestructions, stats.pendingDestructionMemory / 1024);
+	writeLine(line);
+
+	snprintf(line, sizeof(line), "requests: %zu queued, %zu parked, %zu outstanding",
+	         stats.numQueuedRequests, stats.numParkedLoads, stats.numOutstandingRequests);
+	writeLine(line);
+
+	snprintf(line, sizeof(line), "problems: %zu failed loads, %zu fault recoveries, %zu cancelled, %zu abandoned",
+	         stats.numFailedLoads, stats.numFaultRecoveries, stats.numCancelledRequests, stats.numAbandonedLoads);
+	writeLine(line);
+
+	for (size_t n = 0; n < stats.channels.size(); n++)
+	{
+		const streaming::StreamingChannelStats& channelStats = stats.channels[n];
+
+		snprintf(line, sizeof(line), "channel %zu: %llu KB loaded, %.1f KB/s while busy",
+		         n, channelStats.bytesLoaded / 1024, channelStats.GetBytesPerSecond() / 1024.0);
+		writeLine(line);
+	}
+
+	auto writeHistogram = [&](const char* name, const streaming::StreamingHistogram& histogram) {
+		snprintf(line, sizeof(line), "  %-10s avg %llu us, p50 %llu us, p99 %llu us, max %llu us (%llu samples)",
+		         name, histogram.GetAverage(), histogram.GetPercentile(0.5), histogram.GetPercentile(0.99), histogram.maxTime, histogram.numSamples);
+		writeLine(line);
+	};
+
+	for (const streaming::StreamingTypeStats& typeStats : stats.types)
+	{
+		snprintf(line, sizeof(line), "%s: %zu loaded, %zu KB",
+		         GetStreamingTypeName(typeStats.base).c_str(), typeStats.numLoadedResources, typeStats.memoryInUse / 1024);
+		writeLine(line);
+
+		writeHistogram("queue wait", typeStats.queueWaitTime);
+		writeHistogram("io", typeStats.ioTime);
+		writeHistogram("decode", typeStats.decodeTime);
+	}
+}
+
+void Game::DumpStreamingStatsIfNeeded(uint64_t thisTime)
+{
+	if (this->streamingStatsInterval <= 0)
+	{
+		return;
+	}
+
+	if ((thisTime - this->lastStreamingStatsDump) < (uint64_t)this->streamingStatsInterval * 1000)
+	{
+		return;
+	}
+
+	this->lastStreamingStatsDump = thisTime;
+
+	const std::string path = "user:/streaming_stats.log";
+
+	vfs::DevicePtr device = vfs::GetDevice(path);
+
+	if (!device)
+	{
+		return;
+	}
+
+	// append to older dumps
+	auto handle = device->Open(path, false);
+
+	if (handle != INVALID_DEVICE_HANDLE)
+	{
+		device->Seek(handle, 0, SEEK_END);
+	}
+	else
+	{
+		handle = device->Create(path);
+
+		if (handle == INVALID_DEVICE_HANDLE)
+		{
+			return;
+		}
+	}
+
+	auto writeLine = [&](const std::string& line) {
+		const char newLine[] = {'\r', '\n'};
+
+		device->Write(handle, line.c_str(), line.size());
+		device->Write(handle, newLine, sizeof(newLine));
+	};
+
+	writeLine("--- " + std::to_string(thisTime) + " ms");
+
+	WriteStreamingStats(writeLine);
+
+	device->Close(handle);
+}
+
+// prints the streaming telemetry to the console
+ConsoleCommand streamingStatsCommand("streaming_stats", []() {
+	theGame->WriteStreamingStats([](const std::string& line) {
+		console::Printf("%s\n", line.c_str());
+	});
+});
+
+// closes the trace file once the streaming system lets go of it
+struct StreamingTraceFile
+{
+	vfs::DevicePtr device;
+	vfs::Device::THandle handle;
+
+	~StreamingTraceFile()
+	{
+		device->Close(handle);
+	}
+};
+
+bool Game::StartStreamingTrace(const std::string& path)
+{
+	vfs::DevicePtr device = vfs::GetDevice(path);
+
+	if (!device)
+	{
+		return false;
+	}
+
+	auto handle = device->Create(path);
+
+	if (handle == INVALID_DEVICE_HANDLE)
+	{
+		return false;
+	}
+
+	auto traceFile    = std::make_shared<StreamingTraceFile>();
+	traceFile->device = device;
+	traceFile->handle = handle;
+
+	this->streaming.StartTrace([traceFile](const void* data, size_t size) {
+		traceFile->device->Write(traceFile->handle, data, size);
+	});
+
+	return true;
+}
+
+// records a streaming trace, replay it with StreamingBench --replay
+ConsoleCommand streamingTraceStartCommand("streaming_trace_start", []() {
+	const std::string path = "user:/streaming.trace";
+
+	if (theGame->StartStreamingTrace(path))
+	{
+		console::Printf("Recording streaming trace to %s\n", path.c_str());
+	}
+	else
+	{
+		console::Printf("Could not create %s\n", path.c_str());
+	}
+});
+
+ConsoleCommand streamingTraceStopCommand("streaming_trace_stop", []() {
+	theGame->GetStreaming().StopTrace();
+});
+
 void Game::LoadUniverseIfAvailable()
 {
 	// exit if we already have an universe
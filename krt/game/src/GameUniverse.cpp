@@ -5,14 +5,47 @@
 
 #include <vfs/Manager.h>
 #include <vfs/RelativeDevice.h>
+#include <vfs/ThrottledDevice.h>
 
 #include <CdImageDevice.h>
 
 #include <Console.CommandHelpers.h>
+#include <Console.VariableHelpers.h>
 #include <Console.h>
 
 namespace krt
 {
+// Disk model for streaming experiments, reads of the game files are slowed down to it.
+// Has to be set before the game is loaded (like on the command line).
+static int g_throttleSeekLatency;
+static int g_throttleBandwidth;
+static int g_throttleJitter;
+
+static ConVar<int> g_throttleSeekLatencyVar("vfs_throttle_seek", ConVar_None, 0, &g_throttleSeekLatency);   // microseconds
+static ConVar<int> g_throttleBandwidthVar("vfs_throttle_bandwidth", ConVar_None, 0, &g_throttleBandwidth);  // kilobytes per second
+static ConVar<int> g_throttleJitterVar("vfs_throttle_jitter", ConVar_None, 0, &g_throttleJitter);           // microseconds
+
+// CD images are mapped into memory, so that hot entries are served from the page cache without reading them.
+// Has to be set before the images are added.
+static bool g_mapImages;
+
+static ConVar<bool> g_mapImagesVar("vfs_map_images", ConVar_Archive, true, &g_mapImages);
+
+static vfs::DevicePtr MakeThrottledDevice(const vfs::DevicePtr& device)
+{
+	if (g_throttleSeekLatency <= 0 && g_throttleBandwidth <= 0 && g_throttleJitter <= 0)
+	{
+		return device;
+	}
+
+	vfs::ThrottleParameters parameters;
+	parameters.seekLatency    = std::max(g_throttleSeekLatency, 0);
+	parameters.bytesPerSecond = std::max(g_throttleBandwidth, 0) * 1024ULL;
+	parameters.jitter         = std::max(g_throttleJitter, 0);
+
+	return std::make_shared<vfs::ThrottledDevice>(device, parameters);
+}
+
 GameUniverse::GameUniverse(const GameConfiguration& configuration)
     : m_configuration(configuration), m_game(theGame),
 
@@ -35,7 +68,8 @@ GameUniverse::~GameUniverse()
 void GameUniverse::Load()
 {
 	// mount a relative device pointing at the root
-	vfs::DevicePtr device = std::make_shared<vfs::RelativeDevice>(m_configuration.rootPath);
+	// CD images are read through this device as well, so throttling it covers everything
+	vfs::DevicePtr device = MakeThrottledDevice(std::make_shared<vfs::RelativeDevice>(m_configuration.rootPath));
 	vfs::Mount(device, GetMountPoint());
 
 	// load generic.txd if the game has one
@@ -106,7 +140,7 @@ void GameUniverse::AddImage(const std::string& relativePath)
 	std::string imagePath = GetMountPoint() + relativePath;
 	std::string mountPath = imagePath.substr(0, imagePath.find_last_of('.')) + "/";
 
-	if (cdImage->OpenImage(imagePath))
+	if (cdImage->OpenImage(imagePath, g_mapImages))
 	{
 		// create a relative mount referencing the CD image and mount it
 		vfs::DevicePtr relative = std::make_shared<vfs::RelativeDevice>(cdImage, mountPath);
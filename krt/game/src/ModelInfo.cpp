@@ -28,16 +28,38 @@ ModelManager::~ModelManager(void)
 {
 	// We assume there is no more streaming activity.
 
+	// Unload everything in one go, so that unlinking does not have to wait for every model on its own.
+	{
+		std::vector<streaming::ident_t> modelIDs;
+
+		for (ModelResource* model : this->models)
+		{
+			if (model != NULL)
+			{
+				modelIDs.push_back(model->id);
+			}
+		}
+
+		streaming.Unload(modelIDs.data(), modelIDs.size());
+		streaming.LoadingBarrier();
+	}
+
 	for (ModelResource* model : this->models)
 	{
 		if (model != NULL)
 		{
 			streaming.UnlinkResource(model->id);
-
-			delete model;
 		}
 	}
 
+	// Deferred destruction refers to the models.
+	streaming.RunAllDeferredDestructions();
+
+	for (ModelResource* model : this->models)
+	{
+		delete model;
+	}
+
 	this->models.clear();
 	this->modelByName.clear();
 	this->basifierLookup.clear();
@@ -92,6 +114,7 @@ streaming::ident_t ModelManager::RegisterAtomicModel(
 	modelEntry->minimumDistance = 100.0f; // NOTE: only valid for III!
 	modelEntry->flags           = flags;
 	modelEntry->modelPtr        = NULL;
+	modelEntry->memorySize      = 0;
 	modelEntry->modelType       = eModelType::ATOMIC;
 	modelEntry->lod_model       = NULL;
 	modelEntry->non_lod_model   = NULL;
@@ -235,13 +258,14 @@ void ModelManager::LoadAllModels(void)
 
 rw::Object* ModelManager::ModelResource::CloneModel(void)
 {
+	NativeSRW_Exclusive ctxCloneModel(this->lockModelLoading);
+
+	// The model could be unloading, so only look at it under the lock.
 	rw::Object* modelItem = this->modelPtr;
 
 	if (modelItem == NULL)
 		return NULL;
 
-	NativeSRW_Exclusive ctxCloneModel(this->lockModelLoading);
-
 	rw::uint8 modelType = modelItem->type;
 
 	if (modelType == rw::Atomic::ID)
@@ -328,6 +352,82 @@ static rw::Atomic* GetFirstClumpAtomic(rw::Clump* clump)
 	return (firstNodeNameAtom) ? firstNodeNameAtom : firstAtom;
 }
 
+// The vertex and index arrays make up nearly all of the memory of a model.
+static size_t GetGeometryMemorySize(rw::Geometry* geom)
+{
+	size_t numVertices = (size_t)geom->numVertices;
+
+	size_t memSize = sizeof(rw::Geometry);
+
+	// Every morph target has its own positions and maybe normals.
+	for (rw::int32 n = 0; n < geom->numMorphTargets; n++)
+	{
+		const rw::MorphTarget& morphTarget = geom->morphTargets[n];
+
+		memSize += sizeof(rw::MorphTarget);
+
+		if (morphTarget.vertices)
+		{
+			memSize += numVertices * sizeof(rw::V3d);
+		}
+
+		if (morphTarget.normals)
+		{
+			memSize += numVertices * sizeof(rw::V3d);
+		}
+	}
+
+	memSize += (size_t)geom->numTexCoordSets * numVertices * sizeof(rw::TexCoords);
+
+	if (geom->colors)
+	{
+		memSize += numVertices * sizeof(rw::RGBA);
+	}
+
+	memSize += (size_t)geom->numTriangles * sizeof(rw::Triangle);
+
+	if (geom->meshHeader)
+	{
+		memSize += (size_t)geom->meshHeader->totalIndices * sizeof(rw::uint16);
+	}
+
+	return memSize;
+}
+
+static size_t GetModelMemorySize(rw::Object* rwobj)
+{
+	rw::uint8 modelType = rwobj->type;
+
+	if (modelType == rw::Atomic::ID)
+	{
+		rw::Atomic* atomic = (rw::Atomic*)rwobj;
+
+		size_t memSize = sizeof(rw::Atomic);
+
+		if (atomic->geometry)
+		{
+			memSize += GetGeometryMemorySize(atomic->geometry);
+		}
+
+		return memSize;
+	}
+	else if (modelType == rw::Clump::ID)
+	{
+		rw::Clump* clump = (rw::Clump*)rwobj;
+
+		size_t memSize = sizeof(rw::Clump);
+
+		rw::clumpForAllAtomics(clump,
+		    [&](rw::Atomic* atom) {
+			    memSize += GetModelMemorySize((rw::Object*)atom);
+			});
+
+		return memSize;
+	}
+
+	return 0;
+}
+
 void ModelManager::LoadResource(streaming::ident_t localID, const void* dataBuf, size_t memSize)
 {
 	ModelResource* modelEntry = this->models[localID];
@@ -415,7 +515,8 @@ void ModelManager::LoadResource(streaming::ident_t localID, const void* dataBuf,
 	}
 
 	// Store us. :)
-	modelEntry->modelPtr = modelPtr;
+	modelEntry->modelPtr   = modelPtr;
+	modelEntry->memorySize = (modelPtr != NULL) ? GetModelMemorySize(modelPtr) : 0;
 }
 
 void ModelManager::UnloadResource(streaming::ident_t localID)
@@ -424,24 +525,37 @@ void ModelManager::UnloadResource(streaming::ident_t localID)
 
 	assert(modelEntry != NULL);
 
-	NativeSRW_Exclusive ctxUnloadModel(modelEntry->lockModelLoading);
-
-	// Delete GPU data.
+	rw::Object* rwobj = NULL;
+	size_t memorySize = 0;
 	{
-		if (modelEntry->modelPtr != NULL)
-		{
-			rw::Object* rwobj = modelEntry->modelPtr;
+		NativeSRW_Exclusive ctxUnloadModel(modelEntry->lockModelLoading);
 
-			ModelResource::NativeReleaseModel(rwobj);
-		}
+		rwobj      = modelEntry->modelPtr;
+		memorySize = modelEntry->memorySize;
+
+		modelEntry->modelPtr   = NULL;
+		modelEntry->memorySize = 0;
 	}
 
-	modelEntry->modelPtr = NULL;
+	// Delete GPU data later, so that unloading many models does not stall anybody.
+	// Entities keep their clones, which hold their own references to the geometry.
+	if (rwobj != NULL)
+	{
+		streaming.DeferDestruction([modelEntry, rwobj]() {
+			modelEntry->ReleaseModel(rwobj);
+		}, memorySize);
+	}
 }
 
 size_t ModelManager::GetObjectMemorySize(streaming::ident_t localID) const
 {
-	// TODO.
-	return 0;
+	const ModelResource* modelEntry = this->models[localID];
+
+	if (modelEntry == NULL)
+	{
+		return 0;
+	}
+
+	return modelEntry->memorySize;
 }
 }
\ No newline at end of file
@@ -47,11 +47,29 @@ TextureManager::~TextureManager(void)
 
 	// We expect that things cannot stream anymore at this point.
 
+	// Unload everything in one go, so that unlinking does not have to wait for every TXD on its own.
+	{
+		std::vector<streaming::ident_t> texDictIDs;
+
+		for (TexDictResource* texDict : this->texDictList)
+		{
+			texDictIDs.push_back(texDict->id);
+		}
+
+		streaming.Unload(texDictIDs.data(), texDictIDs.size());
+		streaming.LoadingBarrier();
+	}
+
 	// Delete all resource things.
 	for (TexDictResource* texDict : this->texDictList)
 	{
 		streaming.UnlinkResource(texDict->id);
+	}
+
+	streaming.RunAllDeferredDestructions();
 
+	for (TexDictResource* texDict : this->texDictList)
+	{
 		delete texDict;
 	}
 
@@ -72,7 +90,8 @@ void TextureManager::RegisterResource(std::string name, vfs::DevicePtr device, s
 
 	resEntry->id       = curID;
 	resEntry->parentID = -1;
-	resEntry->txdPtr   = NULL;
+	resEntry->txdPtr     = NULL;
+	resEntry->memorySize = 0;
 
 	resEntry->lockResourceLoad = SRWLOCK_INIT;
 
@@ -237,6 +256,51 @@ void TextureManager::UnsetCurrentTXD(void)
 	}
 }
 
+static size_t GetRasterMemorySize(rw::Raster* raster)
+{
+	size_t memSize = sizeof(rw::Raster);
+
+	size_t levelSize = ((size_t)raster->width * raster->height * raster->depth) / 8;
+
+	// A full mip chain adds another third of the top level.
+	if (raster->format & (rw::Raster::MIPMAP | rw::Raster::AUTOMIPMAP))
+	{
+		levelSize += levelSize / 3;
+	}
+
+	memSize += levelSize;
+
+	if (raster->format & rw::Raster::PAL8)
+	{
+		memSize += 256 * sizeof(rw::RGBA);
+	}
+	else if (raster->format & rw::Raster::PAL4)
+	{
+		memSize += 16 * sizeof(rw::RGBA);
+	}
+
+	return memSize;
+}
+
+static size_t GetTexDictMemorySize(rw::TexDictionary* txdObj)
+{
+	size_t memSize = sizeof(rw::TexDictionary);
+
+	FORLIST(lnk, txdObj->textures)
+	{
+		rw::Texture* tex = rw::Texture::fromDict(lnk);
+
+		memSize += sizeof(rw::Texture);
+
+		if (tex->raster)
+		{
+			memSize += GetRasterMemorySize(tex->raster);
+		}
+	}
+
+	return memSize;
+}
+
 void TextureManager::LoadResource(streaming::ident_t localID, const void* dataBuf, size_t memSize)
 {
 	TexDictResource* texEntry = this->texDictList[localID];
@@ -267,7 +331,8 @@ void TextureManager::LoadResource(streaming::ident_t localID, const void* dataBu
 	}
 
 	// Store it :)
-	texEntry->txdPtr = txdRes;
+	texEntry->txdPtr     = txdRes;
+	texEntry->memorySize = GetTexDictMemorySize(txdRes);
 }
 
 void TextureManager::UnloadResource(streaming::ident_t localID)
@@ -276,11 +341,15 @@ void TextureManager::UnloadResource(streaming::ident_t localID)
 
 	assert(texEntry != NULL);
 
-	NativeSRW_Exclusive(texEntry->lockResourceLoad);
+	rw::TexDictionary* txdObj = NULL;
+	size_t memorySize = 0;
 
 	// Unload the TXD again.
 	{
-		rw::TexDictionary* txdObj = texEntry->txdPtr;
+		NativeSRW_Exclusive ctxUnloadTXD(texEntry->lockResourceLoad);
+
+		txdObj     = texEntry->txdPtr;
+		memorySize = texEntry->memorySize;
 
 		assert(txdObj != NULL);
 
@@ -298,15 +367,25 @@ void TextureManager::UnloadResource(streaming::ident_t localID)
 			LIST_FOREACH_END
 		}
 
-		txdObj->destroy();
+		texEntry->txdPtr     = NULL;
+		texEntry->memorySize = 0;
 	}
 
-	texEntry->txdPtr = NULL;
+	// Destroy it later, models that are still around hold their own references to the textures they use.
+	streaming.DeferDestruction([txdObj]() {
+		txdObj->destroy();
+	}, memorySize);
 }
 
 size_t TextureManager::GetObjectMemorySize(streaming::ident_t localID) const
 {
-	// TODO.
-	return 0;
+	const TexDictResource* texEntry = this->texDictList[localID];
+
+	if (texEntry == NULL)
+	{
+		return 0;
+	}
+
+	return texEntry->memorySize;
 }
 }
\ No newline at end of file
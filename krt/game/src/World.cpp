@@ -266,6 +266,9 @@ void World::RenderWorld(void* gfxDevice)
 	std::vector<Entity*> renderList;
 	renderList.reserve(5000);
 
+	this->visibleModelRequests.clear();
+	this->visibleModelDistances.clear();
+
 	LIST_FOREACH_BEGIN (Entity, this->entityList.root, worldNode)
 
 		item->ResetChildrenDrawn();
@@ -316,7 +319,9 @@ void World::RenderWorld(void* gfxDevice)
 
 							    if (streaming.GetResourceStatus(streaming_id) != streaming::StreamMan::eResourceStatus::LOADED)
 							    {
-								    streaming.Request(streaming_id);
+								    // Closer entities should pop in first.
+								    this->visibleModelRequests.push_back(streaming_id);
+								    this->visibleModelDistances.push_back(entityDistance);
 							    }
 						    }
 					    }
@@ -338,6 +343,12 @@ void World::RenderWorld(void* gfxDevice)
 		    }
 		});
 
+	// Request all of the missing models at once instead of locking the streaming queue for every entity.
+	if (this->visibleModelRequests.empty() == false)
+	{
+		streaming.Request(this->visibleModelRequests.data(), this->visibleModelRequests.size(), this->visibleModelDistances.data());
+	}
+
 	for (auto& entity : renderList)
 	{
 		if (entity->ShouldBeDrawn())
@@ -24,8 +24,6 @@ workspace 'krt'
 
     flags { 'Symbols', 'Unicode' }
 
-    includedirs { 'common/include/' }
-
     architecture 'x64'
 
     location 'build/windows/'
@@ -50,6 +48,7 @@ workspace 'krt'
 
         includedirs
         {
+            'common/include',
             'core/include',
             'streaming/include',
             'game/include',
@@ -82,6 +81,41 @@ workspace 'krt'
         pchsource 'common/src/StdInc.cpp'
         pchheader 'StdInc.h'
 
+    -- Streaming benchmark with synthetic resources.
+    -- Builds without RenderWare and the rest of the engine, so it also runs on Linux (premake5 gmake2).
+    project 'streamingbench'
+        targetname 'StreamingBench.%{cfg.buildcfg}'
+        language 'C++'
+        kind 'ConsoleApp'
+        cppdialect 'C++14'
+
+        -- Our own StdInc.h has to be found before the one of the engine.
+        includedirs
+        {
+            'bench/include',
+            'common/include',
+            'streaming/include'
+        }
+
+        files
+        {
+            'bench/**.h',
+            'bench/**.cpp',
+            'streaming/include/Streaming.h',
+            'streaming/include/StreamingBufferPool.h',
+            'streaming/include/StreamingRawCache.h',
+            'streaming/include/StreamingDestructionQueue.h',
+            'streaming/include/StreamingTrace.h',
+            'streaming/src/Streaming.cpp',
+            'streaming/src/StreamingBufferPool.cpp',
+            'streaming/src/StreamingRawCache.cpp',
+            'streaming/src/StreamingDestructionQueue.cpp',
+            'streaming/src/StreamingTrace.cpp'
+        }
+
+        filter 'system:linux'
+            links { 'pthread' }
+
     project 'librw'
         targetname 'librw.%{cfg.buildcfg}'
         language 'C++'
@@ -1,8 +1,8 @@
 #pragma once
 
-#include <utils/IgnoreCaseLess.h>
 #include <vfs/Device.h>
 
+#include <atomic>
 #include <shared_mutex>
 
 namespace krt
@@ -17,7 +17,9 @@ class CdImageDevice : public vfs::Device
 	virtual ~CdImageDevice() override;
 
   public:
-	bool OpenImage(const std::string& imagePath);
+	// If mapImage is set, the whole image is mapped into memory (if the parent device can do that),
+	// so that entries can be handed out with MapBulk and read without going to the parent device.
+	bool OpenImage(const std::string& imagePath, bool mapImage = false);
 
 	virtual THandle Open(const std::string& fileName, bool readOnly) override;
 
@@ -27,12 +29,20 @@ class CdImageDevice : public vfs::Device
 
 	virtual size_t ReadBulk(THandle handle, uint64_t ptr, void* outBuffer, size_t size) override;
 
+	virtual void ReadBulkAsync(THandle handle, uint64_t ptr, void* outBuffer, size_t size, const TReadCallback& callback) override;
+
 	virtual size_t Seek(THandle handle, intptr_t offset, int seekType) override;
 
 	virtual bool Close(THandle handle) override;
 
 	virtual bool CloseBulk(THandle handle) override;
 
+	virtual const void* MapBulk(THandle handle, uint64_t ptr, size_t size) override;
+
+	virtual void UnmapBulk(const void* view, size_t size) override;
+
+	virtual bool IsBulkSpaceShared() override;
+
 	virtual THandle FindFirst(const std::string& folder, vfs::FindData* findData) override;
 
 	virtual bool FindNext(THandle handle, vfs::FindData* findData) override;
@@ -53,25 +63,53 @@ class CdImageDevice : public vfs::Device
 		char name[24];
 	};
 
+	// slot of the entry lookup table, which is open addressed so that lookups do not allocate.
+	struct LookupSlot
+	{
+		uint32_t hash;
+		uint32_t entryIndex;
+	};
+
+	static const uint32_t InvalidEntryIndex = 0xFFFFFFFF; // marks free slots
+
+	// state of a sequential handle, which only belongs to whoever opened it.
+	// a handle must not be used by multiple threads at the same time.
 	struct HandleData
 	{
-		bool valid;
+		std::atomic<bool> valid;
 		Entry entry;
 		size_t curOffset;
 
+		// index + 1 of the next free handle, if this one is in the free list
+		std::atomic<uint32_t> nextFree;
+
 		inline HandleData()
-		    : valid(false)
+		    : valid(false), nextFree(0)
 		{
 		}
 	};
 
+	// handles live in chunks that double in size, so that a chunk never has to move once it is allocated.
+	static const uint32_t FirstHandleChunkSize = 16;
+	static const uint32_t MaxHandleChunks      = 24;
+
   private:
 	const Entry* FindEntry(const std::string& path) const;
 
+	const Entry* LookupEntry(const char* name, size_t nameLength) const;
+
+	void BuildEntryLookup();
+
+	size_t ReadImage(uint64_t ptr, void* outBuffer, size_t size);
+
 	HandleData* AllocateHandle(THandle* outHandle);
 
 	HandleData* GetHandle(THandle inHandle);
 
+	HandleData* GetHandleSlot(uint32_t index);
+
+	void FreeHandle(HandleData* handleData, THandle handle);
+
 	void FillFindData(vfs::FindData* findData, const Entry* entry);
 
   private:
@@ -81,16 +119,29 @@ class CdImageDevice : public vfs::Device
 
 	uint64_t m_parentPtr;
 
+	// the whole image, if it is mapped.
+	const uint8_t* m_mappedImage;
+	size_t m_mappedLength;
+
 	std::string m_pathPrefix;
 
-	HandleData m_handles[16];
+	// sequential handles, allocated without taking lockDeviceConsistency.
+	std::atomic<HandleData*> m_handleChunks[MaxHandleChunks];
+
+	// amount of handle slots that were ever handed out.
+	std::atomic<uint32_t> m_numHandleSlots;
+
+	// free list of handle slots, index + 1 in the low half and an ABA tag in the high half.
+	std::atomic<uint64_t> m_freeHandles;
 
 	std::vector<Entry> m_entries;
 
-	std::map<std::string, Entry*, IgnoreCaseLess> m_entryLookup;
+	// case-insensitive hash table over m_entries, the size is a power of two.
+	std::vector<LookupSlot> m_entryLookup;
 
 	// I do not know how what your vfs design will really be in the end,
 	// so I use a simple shared access lock by following immutability rules.
+	// sequential handles are not protected by it, they belong to whoever opened them.
 	std::shared_timed_mutex lockDeviceConsistency;
 };
 }
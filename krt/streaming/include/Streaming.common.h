@@ -45,6 +45,104 @@ class DeviceResourceLocation : public streaming::ResourceLocation
 		m_device->ReadBulk(handle, ptr, dataBuf, m_length);
 		m_device->CloseBulk(handle);
 	}
+
+	void fetchDataAsync(void* dataBuf, std::function<void(bool)> onFetched) override
+	{
+		uint64_t ptr;
+		auto handle = m_device->OpenBulk(m_path, &ptr);
+
+		if (handle == vfs::Device::InvalidHandle)
+		{
+			onFetched(false);
+			return;
+		}
+
+		// the handle has to stay open until the read is done
+		vfs::DevicePtr device = m_device;
+		size_t length         = m_length;
+
+		m_device->ReadBulkAsync(handle, ptr, dataBuf, m_length, [device, handle, length, onFetched](size_t didRead)
+		{
+			device->CloseBulk(handle);
+
+			onFetched(didRead == length);
+		});
+	}
+
+	bool getBulkLocation(const void*& sourceOut, unsigned long long& offsetOut) const override
+	{
+		// only devices that are archives can read multiple files in one go
+		if (!m_device->IsBulkSpaceShared())
+		{
+			return false;
+		}
+
+		uint64_t ptr;
+		auto handle = m_device->OpenBulk(m_path, &ptr);
+
+		if (handle == vfs::Device::InvalidHandle)
+		{
+			return false;
+		}
+
+		// mapped data is used in place, reading it together with other files would only copy it
+		const void* view = m_device->MapBulk(handle, ptr, m_length);
+
+		if (view)
+		{
+			m_device->UnmapBulk(view, m_length);
+			m_device->CloseBulk(handle);
+
+			return false;
+		}
+
+		m_device->CloseBulk(handle);
+
+		sourceOut = m_device.get();
+		offsetOut = ptr;
+
+		return true;
+	}
+
+	void fetchBulkData(unsigned long long offset, void* dataBuf, size_t dataSize) override
+	{
+		uint64_t ptr;
+		auto handle = m_device->OpenBulk(m_path, &ptr);
+
+		if (handle == vfs::Device::InvalidHandle)
+		{
+			throw std::exception("failed to open bulk handle");
+		}
+
+		size_t didRead = m_device->ReadBulk(handle, offset, dataBuf, dataSize);
+		m_device->CloseBulk(handle);
+
+		if (didRead != dataSize)
+		{
+			throw std::exception("failed to read bulk data");
+		}
+	}
+
+	const void* acquireDataView(void) override
+	{
+		uint64_t ptr;
+		auto handle = m_device->OpenBulk(m_path, &ptr);
+
+		if (handle == vfs::Device::InvalidHandle)
+		{
+			return nullptr;
+		}
+
+		const void* view = m_device->MapBulk(handle, ptr, m_length);
+		m_device->CloseBulk(handle);
+
+		return view;
+	}
+
+	void releaseDataView(const void* dataView) override
+	{
+		m_device->UnmapBulk(dataView, m_length);
+	}
 };
 
 }
\ No newline at end of file
@@ -3,13 +3,18 @@
 #include <utils/NestedLList.h>
 
 #include <atomic>
+#include <functional>
+#include <list>
 
 #include <shared_mutex>
+#include <stdexcept>
 
 #include <utils/DataSlice.h>
 
-// Windows placeholder
-typedef void* HANDLE;
+#include "StreamingBufferPool.h"
+#include "StreamingDestructionQueue.h"
+#include "StreamingRawCache.h"
+#include "StreamingTrace.h"
 
 namespace krt
 {
@@ -23,7 +28,21 @@ struct StreamingTypeInterface abstract
     virtual void LoadResource( ident_t localID, const void *data, size_t dataSize ) = 0;
     virtual void UnloadResource( ident_t localID ) = 0;
 
+    // Memory that a loaded resource takes up in the runtime (like decoded geometry or texture levels).
+    // Asked for right after LoadResource. Return zero if unknown, then the data size is counted instead.
+    // Data that is kept in place (see below) is counted by the streaming system itself.
     virtual size_t GetObjectMemorySize( ident_t localID ) const = 0;
+
+    // Types can hand the destruction of objects to StreamMan::DeferDestruction, so that UnloadResource returns quickly.
+    // The resource then counts as unloaded right away, even though its memory is freed later.
+
+    // OPTIONAL: types that use the data of their resources in place (zero-copy) can return true.
+    // The data that is passed to LoadResource then stays valid until UnloadResource of that resource
+    // has returned, after which it is given back to the streaming buffer pool.
+    virtual bool KeepsResourceData( void ) const
+    {
+        return false;
+    }
 };
 
 // Generic resource location provider!
@@ -36,14 +55,180 @@ struct ResourceLocation abstract
     // Requests data from this resource.
     // This routine might be heavily threaded.
     virtual void fetchData( void *dataBuf ) = 0;
+
+    // OPTIONAL: starts fetching the data without waiting for it, so that many reads can be in flight at once.
+    // onFetched must be called exactly once (on any thread) with whether the data has arrived, dataBuf stays valid until then.
+    // Must not throw, failures are passed to onFetched. By default the data is fetched right away.
+    virtual void fetchDataAsync( void *dataBuf, std::function <void ( bool )> onFetched )
+    {
+        bool isFetched = true;
+
+        try
+        {
+            fetchData( dataBuf );
+        }
+        catch( ... )
+        {
+            isFetched = false;
+        }
+
+        onFetched( isFetched );
+    }
+
+    // OPTIONAL: resources that are stored in the same bulk source (like an archive) can
+    // be read together in one go. Return false if this location cannot do that.
+    // The source just has to be unique to the bulk source, it is never dereferenced.
+    virtual bool getBulkLocation( const void*& sourceOut, unsigned long long& offsetOut ) const
+    {
+        return false;
+    }
+
+    // Reads raw data at any offset of the bulk source of this resource.
+    // Only called if getBulkLocation returned true.
+    virtual void fetchBulkData( unsigned long long offset, void *dataBuf, size_t dataSize )
+    {
+        throw std::runtime_error( "bulk reading is not supported" );
+    }
+
+    // OPTIONAL: hands out a read-only view of the data if this location can do that without copying
+    // (like from a memory-mapped archive). Then the data is given to the streaming type in place.
+    // Return NULL to have the data fetched into a buffer instead.
+    // This routine might be heavily threaded.
+    virtual const void* acquireDataView( void )
+    {
+        return NULL;
+    }
+
+    // Gives back a view of acquireDataView once the streaming system is done with it.
+    virtual void releaseDataView( const void *dataView )
+    {
+        return;
+    }
+};
+
+// Distribution of times in microseconds.
+// Bucket n counts the samples that took less than 2^n microseconds, the last one takes everything that is longer.
+struct StreamingHistogram
+{
+    static const size_t NUM_BUCKETS = 25;   // about 16 seconds.
+
+    unsigned long long buckets[ NUM_BUCKETS ];
+    unsigned long long numSamples;
+    unsigned long long totalTime;
+    unsigned long long maxTime;
+
+    // Upper bound of the bucket that contains the given fraction of samples (like 0.99 for the 99th percentile).
+    unsigned long long GetPercentile( double fraction ) const;
+
+    inline unsigned long long GetAverage( void ) const
+    {
+        return ( this->numSamples != 0 ? this->totalTime / this->numSamples : 0 );
+    }
+};
+
+// Resident memory and load timings of the resources of a single streaming type.
+struct StreamingTypeStats
+{
+    ident_t base;
+    ident_t range;
+
+    size_t memoryInUse;
+    size_t numLoadedResources;
+
+    // Every successful load adds a sample to each.
+    StreamingHistogram queueWaitTime;   // from being queued until it was taken off the queue.
+    StreamingHistogram ioTime;          // reading the data.
+    StreamingHistogram decodeTime;      // giving the data to the streaming type.
+};
+
+struct StreamingChannelStats
+{
+    unsigned long long bytesLoaded;     // data given to the runtime.
+    unsigned long long busyTime;        // microseconds spent on requests.
+
+    // Throughput while the channel was busy.
+    inline double GetBytesPerSecond( void ) const
+    {
+        return ( this->busyTime != 0 ? ( (double)this->bytesLoaded * 1000000.0 ) / (double)this->busyTime : 0.0 );
+    }
 };
 
 struct StreamingStats
 {
     size_t memoryInUse;
     size_t maxMemory;
+
+    // Memory of the streaming buffer pool.
+    size_t bufferMemoryInUse;   // includes buffers kept by streaming types.
+    size_t bufferMemoryIdle;
+
+    // Raw data of resources that is kept in memory (see StreamMan::SetRawCacheMemory).
+    size_t rawCacheMemoryInUse;
+    size_t rawCacheMaxMemory;
+    size_t rawCacheDataSize;        // memory that the cached data would take up without compression.
+    size_t numRawCacheHits;         // loads that did not have to go to the device.
+    size_t numRawCacheMisses;
+
+    // Objects of unloaded resources that still have to be destroyed (see StreamMan::DeferDestruction).
+    size_t numPendingDestructions;
+    size_t pendingDestructionMemory;
+
+    // Work that has been called off by CancelRequest.
+    size_t numCancelledRequests;    // taken back before any channel got to them.
+    size_t numAbandonedLoads;       // already being processed, but stopped before the runtime got the data.
+
+    // Queue depths at the time of the call.
+    size_t numQueuedRequests;       // includes loads in the I/O stage.
+    size_t numParkedLoads;
+    size_t numOutstandingRequests;
+
+    // Things that went wrong.
+    size_t numFailedLoads;
+    size_t numFaultRecoveries;
+
+    std::vector <StreamingChannelStats> channels;
+    std::vector <StreamingTypeStats> types;
+};
+
+// Lets you follow up on a single request without polling or loading barriers.
+struct RequestTicket
+{
+    typedef std::function <void ( ident_t id, bool hasSucceeded )> callback_t;
+
+    RequestTicket( ident_t id );
+
+    inline ident_t GetID( void ) const      { return this->id; }
+
+    // METHODS STARTING FROM HERE ARE SAFE FOR CALLING FROM OTHER THREADS.
+    bool IsDone( void ) const;
+    bool HasSucceeded( void ) const;
+
+    // Blocks until the request has finished and its callbacks have run.
+    // Returns true if the resource has been loaded.
+    bool Wait( void ) const;
+
+    // The callback is run on the thread that finished the request, without streaming locks held.
+    // If the request has already finished then the callback is run right away.
+    void OnCompletion( callback_t callback );
+
+private:
+    friend struct StreamMan;
+
+    void Complete( bool hasSucceeded );
+
+    const ident_t id;
+
+    mutable std::mutex lockCompletion;
+    mutable std::condition_variable condCompletion;
+
+    bool isDone;                            // must be ACCESSED UNDER lockCompletion !
+    bool hasSucceeded;                      // must be ACCESSED UNDER lockCompletion !
+    std::vector <callback_t> callbacks;     // must be ACCESSED UNDER lockCompletion !
+    bool hasRunCallbacks;                   // must be ACCESSED UNDER lockCompletion !
 };
 
+typedef std::shared_ptr <RequestTicket> ticket_t;
+
 // Streaming system by Martin Turski, meow!
 struct StreamMan
 {
@@ -56,13 +241,29 @@ struct StreamMan
         UNLOADING   // being managed
     };
 
-    StreamMan( unsigned int numChannels );
+    // Pass zero channels to scale the channel count with the number of CPU cores.
+    // I/O workers read the data of queued loads ahead while the channels are busy giving data to the runtime.
+    // Pass zero I/O workers to let the channels do all the reading.
+    StreamMan( unsigned int numChannels, unsigned int numIOWorkers = 1 );
     ~StreamMan( void );
 
-    bool Request( ident_t id );
+    // Lower priority values are serviced first (like the distance to the camera).
+    // Requesting an already queued resource again updates its priority.
+    // Pass ticketOut to get notified once the resource has loaded or failed to.
+    bool Request( ident_t id, float priority = 0.0f, ticket_t *ticketOut = NULL );
+
+    // Calls off loading a resource. Queued loads are taken back right away and loads that
+    // are already being processed are stopped before the data is given to the runtime.
+    // Tickets of the request report failure. Returns false if there was nothing to cancel.
     bool CancelRequest( ident_t id );
     bool Unload( ident_t id );
 
+    // Batched versions for whole visibility passes, taking the locks once and waking the channels once.
+    // Pass priorities in the order of the ids or NULL to request all of them at the same priority.
+    // Returns the amount of resources that could be requested.
+    size_t Request( const ident_t *ids, size_t numIDs, const float *priorities = NULL );
+    size_t Unload( const ident_t *ids, size_t numIDs );
+
     void LoadingBarrier( void );
     bool WaitForResource( ident_t id ) const;
 
@@ -70,6 +271,25 @@ struct StreamMan
 
     void GetStatistics( StreamingStats& statsOut ) const;
 
+    // Pass the base that the type was registered with.
+    bool GetTypeStatistics( ident_t base, StreamingTypeStats& statsOut ) const;
+
+    // Starts collecting timings and counters from scratch.
+    void ResetStatistics( void );
+
+    // Records everything the runtime asks for into a binary trace (see StreamingTrace.h) until StopTrace is called.
+    // The current types, resources and dependencies are written first, so that the trace can be replayed on its own.
+    // The writer is called from any thread, but never from two at once.
+    void StartTrace( StreamingTraceRecorder::writer_t writer );
+    void StopTrace( void );
+
+    void SetMaxMemory( size_t maxMemory );
+
+    // Keeps the raw data of loaded and recently evicted resources in memory, so that loading them
+    // again does not have to go to the device. Memory of this cache is not part of the streaming memory budget.
+    // Pass zero to disable the cache (the default). Compressing fits more resources, but costs time on the streaming threads.
+    void SetRawCacheMemory( size_t maxMemory, bool isCompressed = false );
+
     bool RegisterResourceType( ident_t base, ident_t range, StreamingTypeInterface *intf );
     bool UnregisterResourceType( ident_t base );
 
@@ -79,44 +299,100 @@ struct StreamMan
     bool AddResourceDependency( ident_t resID, ident_t dependsOn );
     bool RemoveResourceDependency( ident_t resID, ident_t dependsOn );
 
+    // Queues the destruction of an object of an unloaded resource, so that big unload waves are spread out.
+    // Destructors run in the order they were queued, by RunDeferredDestructions, by the destruction thread
+    // or at the latest when the manager is destroyed. Types have to make sure that their destructors have run
+    // before the objects that they refer to go away (see RunAllDeferredDestructions).
+    void DeferDestruction( StreamingDestructionQueue::destructor_t destructor, size_t memorySize = 0 );
+
+    // Runs queued destructors until the time budget (in microseconds) is used up, like once per frame.
+    size_t RunDeferredDestructions( unsigned long long timeBudget );
+    void RunAllDeferredDestructions( void );
+
+    // Runs queued destructors on their own thread as soon as they come in.
+    // Only enable it if all destructors can run on any thread.
+    void SetDestructionThread( bool isEnabled );
+
 private:
     // METHODS THAT ARE PRIVATE ARE MEANT TO BE PRIVATE.
     // Be careful exposing anything because this is a threaded structure!
 
     bool CheckTypeRegionConflict( ident_t base, ident_t range ) const;
 
+    // All data is read into buffers of this pool.
+    // Declared first, because resources and channels hold buffers until they are destroyed.
+    StreamingBufferPool bufferPool;
+
+    // Objects of unloaded resources that still have to be destroyed.
+    StreamingDestructionQueue destructionQueue;
+
+    // Second tier, used before reading from the device.
+    // Its lock is never held while taking another one.
+    StreamingRawCache rawCache;
+
     struct Channel;
+    struct Resource;
+    struct reg_streaming_type;
+
+    // Every ident owns a slot in the resource table.
+    // Slots stay alive for as long as the manager does, so the words in them can be read without any lock.
+    struct resourceSlot_t
+    {
+        inline resourceSlot_t( void ) : status( eResourceStatus::UNLOADED ), lastUseTime( 0 ), res( NULL )
+        {
+            this->typeInfo = NULL;
+        }
+
+        std::atomic <eResourceStatus> status;               // UNLOADED if no resource is linked.
+        std::atomic <unsigned long long> lastUseTime;       // tick of the use clock when this ident was last asked for.
+        std::atomic <Resource*> res;                        // must be MODIFIED UNDER EXCLUSIVE-ACCESS in lockResourceAvail !
+
+        reg_streaming_type *typeInfo;   // must be ACCESSED UNDER lockStreamingTypeMutate !
+    };
 
     struct Resource
     {
-        inline Resource( ident_t id, std::string name, ResourceLocation *loc )
-            : id( id ), name( std::move( name ) ), status( eResourceStatus::UNLOADED ), refCount( 0 )
+        inline Resource( ident_t id, std::string name, ResourceLocation *loc, resourceSlot_t& slot )
+            : id( id ), name( std::move( name ) ), slot( slot ), status( slot.status ), refCount( 0 )
         {
+            this->status = eResourceStatus::UNLOADED;
             this->location = loc;
             this->isAllowedToLoad = true;
             this->syncOwner = NULL;
+            this->slot.lastUseTime = 0;
+            this->isEvictionPending = false;
+            this->pendingEvictionSize = 0;
+            this->residentSize = 0;
+            this->queueTime = 0;
+            this->queueWaitTime = 0;
+            this->ioTime = 0;
+            this->queueIndex = NOT_QUEUED;
+            this->isInReadStage = false;
+            this->numTakenLoads = 0;
+            this->isParked = false;
+            this->loadPriority = 0.0f;
+            this->loadGeneration = 0;
+            this->wantedGeneration = 0;
 
             this->resourceSize = loc->getDataSize();
-        }
 
-        inline Resource( Resource&& right ) : id( right.id ), name( std::move( right.name ) ), status(), refCount()
-        {
-            this->status = right.status.load();
-            this->location = right.location;
-            this->isAllowedToLoad = right.isAllowedToLoad;
-            this->resourceSize = right.resourceSize;
-            this->syncOwner = right.syncOwner;
-            this->depends = std::move( right.depends );
+            if ( loc->getBulkLocation( this->bulkSource, this->bulkOffset ) == false )
+            {
+                this->bulkSource = NULL;
+                this->bulkOffset = 0;
+            }
         }
 
         const ident_t id;
 
         const std::string name;
-        std::atomic <eResourceStatus> status;
+        resourceSlot_t& slot;
+        std::atomic <eResourceStatus>& status;  // lives in the slot.
         ResourceLocation *location;
         bool isAllowedToLoad;
 
-        Channel *syncOwner;
+        // Read without locks by loads that want to know whether they have to wait for this resource.
+        std::atomic <Channel*> syncOwner;
 
         std::vector <Resource*> depends;    // Resource dependencies that have to be loaded before this resource.
 
@@ -128,6 +404,65 @@ private:
 
         // Meta-data.
         size_t resourceSize;
+        size_t residentSize;    // memory that we count while LOADED, set by the loading channel.
+
+        const void *bulkSource;         // NULL if this resource cannot be read together with others.
+        unsigned long long bulkOffset;
+
+        // Tickets of requests that wait for this resource to finish loading.
+        std::vector <ticket_t> waitingTickets;  // must be ACCESSED UNDER lockTickets !
+
+        // Residency management.
+        bool isEvictionPending;     // must be MODIFIED UNDER EXCLUSIVE-ACCESS in lockEviction !
+        size_t pendingEvictionSize; // same here.
+
+        // Position of the queued LOAD request of this resource in the requestQueue.
+        // must be ACCESSED UNDER lockRequestQueue !
+        static const size_t NOT_QUEUED = (size_t)-1;
+
+        size_t queueIndex;
+
+        // Data that the streaming type uses in place while the resource is loaded.
+        StreamingBuffer retainedBuffer;
+
+        // Telemetry of the current load, in microseconds.
+        unsigned long long queueTime;                   // when it was queued, must be ACCESSED UNDER lockRequestQueue !
+        std::atomic <unsigned long long> queueWaitTime; // set when it leaves the queue.
+        std::atomic <unsigned long long> ioTime;        // set by whoever reads the data.
+
+        // True while the LOAD request of this resource is in the I/O stage.
+        bool isInReadStage;     // must be ACCESSED UNDER lockRequestQueue !
+
+        // LOAD requests that channels have taken but not acquired the resource for yet.
+        unsigned int numTakenLoads; // must be ACCESSED UNDER lockRequestQueue !
+
+        // Loads that wait for their dependencies are parked instead of blocking a channel.
+        // all of these must be ACCESSED UNDER lockRequestQueue !
+        bool isParked;
+        float loadPriority;                         // priority that the LOAD request was last queued with.
+        StreamingBuffer parkedData;                 // data that had been read before the load was parked.
+        std::vector <Resource*> parkedOn;           // dependencies that the parked load waits for.
+        std::vector <Resource*> parkedDependents;   // parked loads that wait for this resource.
+
+        // Cancellation.
+        // Every cancellation starts a new generation. A load is only carried out if it has been
+        // wanted (queued or requested) since the last cancellation.
+        std::atomic <unsigned int> loadGeneration;
+        std::atomic <unsigned int> wantedGeneration;
+
+        inline void MarkLoadWanted( void )
+        {
+            unsigned int generation = this->loadGeneration;
+            unsigned int wanted = this->wantedGeneration;
+
+            // Never go back to an older generation.
+            while ( wanted < generation && this->wantedGeneration.compare_exchange_weak( wanted, generation ) == false );
+        }
+
+        inline bool IsLoadCancelled( void ) const
+        {
+            return ( this->wantedGeneration != this->loadGeneration );
+        }
 
         // PRIVATE METHODS THAT ARE MEANT TO BE USED VERY CAREFULLY.
         // must be executed from SHARED-ACCESS from lockResourceAvail at least.
@@ -180,9 +515,69 @@ private:
         }
     };
 
-    typedef std::map <ident_t, Resource> resMap_t;
+    // Flat table of resource slots, addressed by ident.
+    // Idents are handed out in dense ranges, so the table is split into pages that are only
+    // allocated for ranges that are in use. Looking up a slot never takes a lock.
+    struct ResourceTable
+    {
+        static const ident_t PAGE_SIZE = 1024;
+        static const ident_t MAX_PAGES = 4096;
+
+        ResourceTable( void );
+        ~ResourceTable( void );
+
+        // THREAD-SAFE. Returns NULL if no slot was ever allocated for this ident.
+        inline resourceSlot_t* GetSlot( ident_t id ) const
+        {
+            if ( id < 0 || id >= ( PAGE_SIZE * MAX_PAGES ) )
+                return NULL;
+
+            slotPage_t *page = this->pages[ id / PAGE_SIZE ].load( std::memory_order_acquire );
+
+            if ( page == NULL )
+                return NULL;
+
+            return &page->slots[ id % PAGE_SIZE ];
+        }
+
+        // THREAD-SAFE. Returns NULL if the ident cannot be put into the table.
+        resourceSlot_t* AllocateSlot( ident_t id );
+
+        // Calls the callback for every linked resource.
+        // must be executed from SHARED-ACCESS from lockResourceAvail at least.
+        template <typename callbackType>
+        inline void ForAllResources( const callbackType& cb ) const
+        {
+            size_t numPages = this->numUsedPages.load( std::memory_order_acquire );
+
+            for ( size_t pageIdx = 0; pageIdx < numPages; pageIdx++ )
+            {
+                slotPage_t *page = this->pages[ pageIdx ].load( std::memory_order_acquire );
+
+                if ( page == NULL )
+                    continue;
+
+                for ( resourceSlot_t& slot : page->slots )
+                {
+                    if ( Resource *res = slot.res.load( std::memory_order_acquire ) )
+                    {
+                        cb( res );
+                    }
+                }
+            }
+        }
+
+    private:
+        struct slotPage_t
+        {
+            resourceSlot_t slots[ PAGE_SIZE ];
+        };
+
+        std::atomic <slotPage_t*> pages[ MAX_PAGES ];
+        std::atomic <size_t> numUsedPages;      // all pages after this count are NULL.
+    };
 
-    resMap_t resources;
+    ResourceTable resourceTable;
 
     mutable std::shared_timed_mutex lockResourceContest;
     // this lock has to be taken when the resource system state is changing.
@@ -198,32 +593,55 @@ private:
 
     inline Resource* GetResourceAtID( ident_t id )
     {
-        resMap_t::iterator foundIter = resources.find( id );
+        resourceSlot_t *slot = this->resourceTable.GetSlot( id );
 
-        if ( foundIter == resources.end() )
+        if ( slot == NULL )
             return NULL;
 
-        return &(*foundIter).second;
+        return slot->res;
     }
 
     inline const Resource* GetConstResourceAtID( ident_t id ) const
     {
-        resMap_t::const_iterator foundIter = resources.find( id );
+        const resourceSlot_t *slot = this->resourceTable.GetSlot( id );
 
-        if ( foundIter == resources.end() )
+        if ( slot == NULL )
             return NULL;
 
-        return &(*foundIter).second;
+        return slot->res;
     }
 
     typedef sliceOfData <ident_t> identSlice_t;
 
+    // Filled by any thread without locks.
+    struct latencyHistogram_t
+    {
+        latencyHistogram_t( void );
+
+        void Record( unsigned long long time );
+        void Reset( void );
+        void GetSnapshot( StreamingHistogram& histogramOut ) const;
+
+    private:
+        std::atomic <unsigned long long> buckets[ StreamingHistogram::NUM_BUCKETS ];
+        std::atomic <unsigned long long> numSamples;
+        std::atomic <unsigned long long> totalTime;
+        std::atomic <unsigned long long> maxTime;
+    };
+
     struct reg_streaming_type
     {
         StreamingTypeInterface *manager;
         ident_t base;
         ident_t range;
 
+        std::atomic <size_t> memoryInUse;
+        std::atomic <size_t> numLoadedResources;
+
+        latencyHistogram_t queueWaitTime;
+        latencyHistogram_t ioTime;
+        latencyHistogram_t decodeTime;
+
         inline bool operator ==( const reg_streaming_type& right ) const
         {
             return ( this->base == right.base && this->range == right.range );
@@ -231,21 +649,31 @@ private:
     };
 
     reg_streaming_type* GetStreamingTypeAtID( ident_t id );
+    const reg_streaming_type* GetStreamingTypeAtID( ident_t id ) const;
+
+    void NativeGetTypeStatistics( const reg_streaming_type& typeInfo, StreamingTypeStats& statsOut ) const;
 
     void ClearResourcesAtSlot( ident_t resID, ident_t range );
 
     bool UnlinkResourceNative( ident_t resID, bool doLock );
 
-    std::vector <reg_streaming_type> types;
+    // Slots point at the registered types, so they must not move in memory.
+    std::list <reg_streaming_type> types;
+
+    struct readAheadLoad_t;
 
     struct Channel
     {
-        Channel( StreamMan *manager );
+        Channel( StreamMan *manager, unsigned int channelIndex );
         ~Channel( void );
 
         static void StreamingChannelRuntime( void *ud );
 
-        enum class eRequestType
+        // Blocks until the channel thread has quit. isTerminating must have been set.
+        void WaitForTermination( void );
+
+        // Small enough for requests to fit into the lock-free deques.
+        enum class eRequestType : unsigned char
         {
             LOAD,
             UNLOAD
@@ -257,6 +685,8 @@ private:
             {
                 this->resID = -1;
                 this->reqType = eRequestType::UNLOAD;
+                this->isEviction = false;
+                this->isResumed = false;
             }
 
             inline bool operator ==( const request_t& right ) const
@@ -266,35 +696,27 @@ private:
 
             ident_t resID;
             eRequestType reqType;
+            bool isEviction;    // issued by the memory budget, not by the runtime.
+            bool isResumed;     // the load has been parked before, so it loads its dependencies by itself.
         };
 
     private:
         StreamMan *manager;
 
-    public:
-        std::list <request_t> requests;
-
     private:
         std::thread thread;
 
     public:
-        mutable std::shared_timed_mutex channelLock;  // access lock to fields.
+        const unsigned int channelIndex;
 
-        mutable std::mutex lockIsActive;
-        mutable std::condition_variable condIsActive;
+        mutable std::shared_timed_mutex channelLock;  // access lock to fields.
 
         mutable std::mutex lockReqProcess;
         mutable std::condition_variable condReqProcess;
 
-        HANDLE semRequestCount;
-        HANDLE terminationEvent;
-
-        bool isActive;
-
-    private:
-        // FIELDS STARTING FROM HERE ARE PRIVATE TO CHANNEL THREAD.
-        std::vector <char> dataBuffer;
+        std::atomic <bool> isTerminating;
 
+    public:
         // FIELDS STARTING FROM HERE ARE ONLY WRITE-ABLE BY CHANNEL THREAD.
         struct Activity
         {
@@ -302,23 +724,33 @@ private:
             NestedListEntry <Activity> node;
         };
 
-        NestedList <Activity> activities;
-
-    public:
-        // only THREAD-SAFE is called from STREAMING-THREAD.
-        inline void* GetStreamingBuffer( size_t resourceSize )
+        // FIELDS STARTING FROM HERE ARE PRIVATE TO CHANNEL THREAD.
+        // Loads that are processed together because their resources are stored next to each other.
+        struct batchedLoad_t
         {
-            // Ensure that we have enough space in our loading buffer to store the resource.
-            {
-                if ( this->dataBuffer.size() < resourceSize )
-                {
-                    this->dataBuffer.resize( resourceSize );
-                }
-            }
+            request_t request;
+            Resource *res;
+            Activity *activity;
+            const void *prefetchedData;     // points into the batchBuffer if the bulk read succeeded.
+        };
 
-            return this->dataBuffer.data();
-        }
+        std::vector <batchedLoad_t> batchedLoads;
+        StreamingBuffer batchBuffer;
+
+        // Set if the current request has been read by the I/O stage.
+        readAheadLoad_t *readAheadLoad;
+
+        // Tickets are completed once this channel does not hold any streaming locks anymore.
+        std::vector <std::pair <ticket_t, bool>> finishedTickets;
 
+        // Telemetry.
+        std::atomic <unsigned long long> bytesLoaded;
+        std::atomic <unsigned long long> busyTime;
+
+    private:
+        NestedList <Activity> activities;
+
+    public:
         // only THREAD-SAFE if called from EXLUSIVE-LOCK at channelLock
         inline Activity* AllocateActivity( request_t req )
         {
@@ -372,22 +804,234 @@ private:
             return IsChannelProcessingNoLock( id );
         }
 
+        // Thrown by a load that needs a resource that another channel is processing.
+        // The load is suspended on that resource instead of blocking the channel.
+        struct loadSuspension_t
+        {
+            ident_t waitForID;
+        };
+
+        // Thrown by a load that has been cancelled while it was being processed.
+        struct loadCancellation_t
+        {
+        };
+
     private:
+        void RunRequest( const request_t& request, Activity *mainActivity, const void *prefetchedData, StreamingBuffer *prefetchedBuffer );
+
         Resource* AcquireResourceContext( Resource *wantedResource, eRequestType reqType );
 
-        void ProcessResourceRequest( StreamMan *manager, Resource *resToLoad, eRequestType reqType );
+        void ProcessResourceRequest( StreamMan *manager, Resource *resToLoad, eRequestType reqType, const void *prefetchedData = NULL, StreamingBuffer *prefetchedBuffer = NULL, bool isCancellable = false );
     };
 
     std::vector <Channel*> channels;
 
+    // Requests of all channels are kept in a shared priority queue, so that
+    // the most urgent request is always taken first by any free channel.
+    // only THREAD-SAFE if called from EXCLUSIVE-LOCK at lockRequestQueue !
+    struct RequestQueue
+    {
+        RequestQueue( void );
+
+        // Returns false if the request was merged with an already queued one.
+        // LOAD requests are merged by their resource, so res should be given if it exists.
+        bool Push( Channel::request_t request, Resource *res, float priority );
+        bool Pop( Channel::request_t& requestOut, Resource **loadResOut = NULL );
+
+        bool IsQueued( ident_t id ) const;
+
+        // Takes the queued LOAD requests of resources that are stored close to the given one.
+        void TakeBulkNeighbours( const Resource *res, std::vector <Channel::batchedLoad_t>& batchOut );
+
+        // Takes back the queued LOAD request of a resource, if there is one.
+        bool RemoveLoad( Resource *res );
+
+        inline bool IsEmpty( void ) const
+        {
+            return this->heap.empty();
+        }
+
+        inline size_t GetCount( void ) const
+        {
+            return this->heap.size();
+        }
+
+        inline bool IsLoadOnTop( void ) const
+        {
+            return ( this->heap.empty() == false && this->heap.front().loadRes != NULL );
+        }
+
+        // NULL if there is no LOAD on top.
+        inline Resource* GetTopLoad( void ) const
+        {
+            return ( this->heap.empty() == false ? this->heap.front().loadRes : NULL );
+        }
+
+    private:
+        struct entry_t
+        {
+            Channel::request_t request;
+            Resource *loadRes;              // the resource that is queued for loading, if this is a LOAD request.
+            float priority;
+            unsigned long long sequence;    // keeps requests of equal priority in FIFO order.
+        };
+
+        inline static bool IsMoreUrgent( const entry_t& left, const entry_t& right )
+        {
+            if ( left.priority != right.priority )
+            {
+                return ( left.priority < right.priority );
+            }
+
+            return ( left.sequence < right.sequence );
+        }
+
+        void SetEntry( size_t idx, entry_t entry );
+        void RemoveAt( size_t idx );
+
+        void SiftUp( size_t idx );
+        void SiftDown( size_t idx );
+
+        std::vector <entry_t> heap;     // binary heap, most urgent entry at the top.
+
+        std::vector <Resource*> bulkCandidates;     // kept around so that taking neighbours does not allocate.
+
+        unsigned long long curSequence;
+    };
+
+    RequestQueue requestQueue;
+
+    mutable std::mutex lockRequestQueue;
+    // must lock when accessing the requestQueue.
+
+    mutable std::condition_variable condQueueUpdate;
+    // notified when requests leave the requestQueue.
+
+    // Requests that are waiting in the requestQueue or in any channel deque.
+    std::atomic <size_t> numQueuedRequests;
+
+    // Requests that have been pushed but not finished processing yet.
+    std::atomic <size_t> numOutstandingRequests;
+
+    mutable std::mutex lockOutstanding;
+    mutable std::condition_variable condAllRequestsDone;
+
+    // Channels without work sleep here.
+    std::mutex lockChannelIdle;
+    std::condition_variable condWorkAvailable;
+
+    std::atomic <unsigned int> numIdleChannels;
+
+    // I/O stage of the loading pipeline.
+    // I/O workers take LOAD requests off the requestQueue and read their data, so that channels
+    // only have to give it to the runtime. Loads in this stage still count as queued for anybody waiting
+    // on them, but channels can only take them once they have been read.
+    // The stage is bounded, so that reading cannot run away from the channels.
+    struct readAheadLoad_t
+    {
+        Channel::request_t request;
+        Resource *res;
+        size_t dataSize;
+
+        StreamingBuffer buffer;     // taken by the channel if the streaming type keeps the data.
+
+        bool isRead;        // the I/O worker is done with this load.
+        bool hasData;       // false if reading failed, then the channel tries on its own.
+    };
+
+    std::vector <readAheadLoad_t*> readStage;       // in the order that loads were taken off the requestQueue.
+    std::vector <readAheadLoad_t*> freeReadLoads;   // recycled, so that loads do not have to be allocated all the time.
+
+    size_t readStageMemory;     // data size of all loads in the readStage.
+
+    // all of the above must be ACCESSED UNDER lockRequestQueue !
+
+    mutable std::condition_variable condReadAhead;
+    // notified when I/O workers could take new loads (uses lockRequestQueue).
+
+    std::vector <std::thread> ioWorkers;
+
+    void NativeIOWorkerRuntime( void );
+    void NativeFinishReadAhead( readAheadLoad_t *readLoad );
+    bool NativeCanReadAhead( void ) const;
+    bool NativeIsInReadStage( ident_t id ) const;
+    void NativeRemoveFromReadStage( Resource *res, std::unique_lock <std::mutex>& ctxQueueLock );
+    void NativeRecycleReadLoad( readAheadLoad_t *readLoad );
+    void NativeReleaseReadAhead( Channel *channel );
+
+    // Dependency fan-out.
+    // A load whose dependencies are not loaded yet is parked and its dependencies are queued,
+    // so that other channels load them at the same time. Once all of them have finished processing
+    // the load is queued again, straight into the I/O stage if its data had been read already.
+    // Loads that run into a resource which another channel is processing are suspended the same way,
+    // so that no channel ever sleeps on the work of another.
+    std::vector <Resource*> parkedLoads;    // must be ACCESSED UNDER lockRequestQueue !
+
+    std::atomic <size_t> numParkedLoads;    // includes loads that are about to be parked.
+
+    bool NativeParkLoad( const Channel::request_t& request, StreamingBuffer *prefetchedBuffer );
+    bool NativeSuspendLoad( const Channel::request_t& request, ident_t waitForID, StreamingBuffer *prefetchedBuffer );
+    void NativeParkOn( Resource *res, Resource *waitFor );
+    void NativeFinishParking( Resource *res, StreamingBuffer *prefetchedBuffer );
+    void NativeRequeueLoad( Resource *res );
+    bool NativeIsParked( ident_t id ) const;
+    void NativeResumeDependents( Resource *res );
+    void NativeResumeDependentsNoLock( Resource *res );
+    void NativeResumeParkedLoad( Resource *res );
+    void NativeDropParkedLoad( Resource *res );
+    void NativeRemoveParkedLoad( Resource *res );
+
     void ResourceFaultRecovery( Channel *channel, Resource *faultyRes, Channel::eRequestType reqType );
 
-    void NativeProcessStreamingRequest( Channel::eRequestType reqType, Channel *loadingChannel, Resource *resToLoad );
+    mutable std::mutex lockTickets;
+    // must lock when accessing the waitingTickets of any resource.
+
+    // Takes the tickets that wait for a resource, so that they can be completed outside of locks.
+    void NativeTakeTickets( Resource *res, bool hasSucceeded, std::vector <std::pair <ticket_t, bool>>& ticketsOut );
+    static void NativeCompleteTickets( std::vector <std::pair <ticket_t, bool>>& tickets );
+
+    // Residency management.
+    inline void TouchResource( resourceSlot_t& slot ) const
+    {
+        slot.lastUseTime = ++this->useClock;
+    }
+
+    // Does not advance the clock, for uses that happen all the time (like status queries every frame).
+    // Resources used like this count as recent as the last resource that advanced the clock.
+    inline void TouchResourceRelaxed( resourceSlot_t& slot ) const
+    {
+        unsigned long long curTime = this->useClock.load( std::memory_order_relaxed );
+
+        // Do not write to the slot over and over again.
+        if ( slot.lastUseTime.load( std::memory_order_relaxed ) != curTime )
+        {
+            slot.lastUseTime.store( curTime, std::memory_order_relaxed );
+        }
+    }
+
+    void EnforceMemoryBudget( void );
+    void ClearEvictionPending( Resource *res );
+
+    // Data can be given either in a buffer that can be taken or as plain data that has to be copied if it is kept.
+    // Dependencies that are loaded on behalf of another load cannot be cancelled.
+    void NativeProcessStreamingRequest( Channel::eRequestType reqType, Channel *loadingChannel, Resource *resToLoad, const void *prefetchedData = NULL, StreamingBuffer *prefetchedBuffer = NULL, bool isCancellable = false );
 
-    void NativePushChannelRequest( Channel *channel, Channel::request_t request );
-    Channel* NativePushStreamingRequest( Channel::request_t request );
+    // Requests that are pushed by a channel go into its local deque instead of the shared queue.
+    void NativePushStreamingRequest( Channel::request_t request, Resource *res, float priority );
 
-    void NativeChannelWaitForCompletion( Channel *channel ) const;
+    // Returns the amount of requests that were really added, because requests can be merged or superseded.
+    // only THREAD-SAFE if called from EXCLUSIVE-LOCK at lockRequestQueue !
+    size_t NativeQueueRequestNoLock( Channel::request_t request, Resource *res, float priority );
+    void NativeQueueRequests( size_t numNewRequests, size_t numNewLoads );
+
+    bool NativeFetchRequest( Channel *channel, Channel::request_t& requestOut, Channel::Activity*& activityOut );
+    bool NativeWaitForWork( Channel *channel );
+    void NativeReadBatchedLoads( std::vector <Channel::batchedLoad_t>& batch, StreamingBuffer& batchBuffer );
+    void NativeFetchResourceData( Resource *res, void *dataBuf );
+    void NativeWakeChannels( size_t numNewRequests = 1 );
+    void NativeFinishRequest( void );
+
+    void NativeWaitForAllRequests( void ) const;
     void NativeChannelWaitForResourceCompletion( Channel *channel, ident_t resID ) const;
     bool NativeWaitForResourceActivity( ident_t id ) const;
 
@@ -398,12 +1042,40 @@ private:
     };
 
     // Some management variables.
-    std::atomic <unsigned int> currentChannelID;    // used to balance the load between channels.
-
     std::atomic <size_t> maxMemory;
     std::atomic <size_t> totalStreamingMemoryUsage;
 
-    bool isTerminating;
+    mutable std::atomic <unsigned long long> useClock;  // logical time for least-recently-used eviction.
+
+    std::atomic <size_t> pendingEvictionMemory;     // memory that is about to be freed by queued eviction requests.
+
+    std::atomic <size_t> numCancelledRequests;
+    std::atomic <size_t> numAbandonedLoads;
+
+    std::atomic <size_t> numFailedLoads;
+    std::atomic <size_t> numFaultRecoveries;
+
+    mutable std::mutex lockEviction;
+    // must lock when selecting eviction victims or changing eviction state of resources.
+
+    // Tracing.
+    inline void TraceEvent( StreamingTraceRecord::eType type, ident_t id, unsigned int arg0 = 0, unsigned int arg1 = 0, unsigned int arg2 = 0, unsigned int arg3 = 0 ) const
+    {
+        if ( this->isTracing.load( std::memory_order_relaxed ) )
+        {
+            NativeTraceEvent( type, id, arg0, arg1, arg2, arg3 );
+        }
+    }
+
+    void NativeTraceEvent( StreamingTraceRecord::eType type, ident_t id, unsigned int arg0, unsigned int arg1, unsigned int arg2, unsigned int arg3 ) const;
+
+    mutable std::mutex lockTrace;
+    // must lock when recording into the trace. No other lock may be taken while holding it.
+
+    std::unique_ptr <StreamingTraceRecorder> traceRecorder;    // must be ACCESSED UNDER lockTrace !
+    std::atomic <bool> isTracing;
+
+    std::atomic <bool> isTerminating;
 };
 
 }
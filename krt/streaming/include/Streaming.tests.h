@@ -13,6 +13,18 @@ void Test1( void ); // the first and most amazing test we came up with!!!
 void Test2( void ); // meow-test.
 void Test3( void );
 void FaultTest1( void );
+void EvictionTest1( void );   // memory budget has to be respected.
+void TicketTest1( void );     // waiting for single requests.
+void BufferTest1( void );     // streaming types can keep their data.
+void DependencyTest1( void ); // dependencies load on other channels.
+void CancelTest1( void );     // cancelled requests do not load.
+void BatchTest1( void );      // whole visibility sets at once.
+void MemoryTest1( void );     // resident memory is counted per type.
+void TelemetryTest1( void );  // every load is accounted for.
+void RawCacheTest1( void );   // loading again does not read again.
+void DestructionTest1( void ); // unloaded objects are destroyed by the queue.
+void MappedTest1( void );      // mapped data is loaded in place.
+void AsyncReadTest1( void );   // the I/O worker keeps many reads in flight.
 
 }
 
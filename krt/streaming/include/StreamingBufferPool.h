@@ -0,0 +1,117 @@
+#pragma once
+
+// Shared pool of buffers for streaming data.
+// Buffers are handed out in power-of-two size classes, so that they can be reused by resources
+// of similar size. Buffers that are given back are kept around up to a memory cap.
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace krt
+{
+namespace streaming
+{
+
+struct StreamingBufferPool;
+
+// Owning handle to a buffer of the pool.
+// The buffer goes back to the pool once the handle is released or destroyed.
+struct StreamingBuffer
+{
+    inline StreamingBuffer( void ) : pool( NULL ), data( NULL ), size( 0 ), sizeClass( 0 )
+    {
+    }
+
+    inline StreamingBuffer( StreamingBuffer&& right ) : pool( right.pool ), data( right.data ), size( right.size ), sizeClass( right.sizeClass )
+    {
+        right.pool = NULL;
+        right.data = NULL;
+        right.size = 0;
+    }
+
+    inline ~StreamingBuffer( void )
+    {
+        Release();
+    }
+
+    StreamingBuffer( const StreamingBuffer& ) = delete;
+    StreamingBuffer& operator = ( const StreamingBuffer& ) = delete;
+
+    inline StreamingBuffer& operator = ( StreamingBuffer&& right )
+    {
+        if ( this != &right )
+        {
+            Release();
+
+            this->pool = right.pool;
+            this->data = right.data;
+            this->size = right.size;
+            this->sizeClass = right.sizeClass;
+
+            right.pool = NULL;
+            right.data = NULL;
+            right.size = 0;
+        }
+
+        return *this;
+    }
+
+    void Release( void );
+
+    inline void* GetData( void ) const          { return this->data; }
+    inline size_t GetSize( void ) const         { return this->size; }
+    inline bool IsValid( void ) const           { return ( this->data != NULL ); }
+
+private:
+    friend struct StreamingBufferPool;
+
+    StreamingBufferPool *pool;
+    void *data;
+    size_t size;
+    unsigned int sizeClass;
+};
+
+struct StreamingBufferPool
+{
+    // Size class n holds buffers of ( MIN_CLASS_SIZE << n ) bytes.
+    // Bigger buffers are not pooled at all.
+    static const unsigned int NUM_SIZE_CLASSES = 13;
+    static const size_t MIN_CLASS_SIZE = 4096;
+
+    StreamingBufferPool( size_t maxIdleMemory );
+    ~StreamingBufferPool( void );
+
+    // THREAD-SAFE. Throws std::bad_alloc if there is no memory left.
+    StreamingBuffer Allocate( size_t size );
+
+    // THREAD-SAFE. Frees all buffers that are not in use.
+    void Trim( void );
+
+    // THREAD-SAFE.
+    void SetMaxIdleMemory( size_t maxIdleMemory );
+
+    inline size_t GetMemoryInUse( void ) const  { return this->memoryInUse; }
+    inline size_t GetIdleMemory( void ) const   { return this->idleMemory; }
+
+private:
+    friend struct StreamingBuffer;
+
+    void Free( void *data, size_t size, unsigned int sizeClass );
+
+    static inline size_t GetClassSize( unsigned int sizeClass )
+    {
+        return ( MIN_CLASS_SIZE << sizeClass );
+    }
+
+    std::mutex lockFreeLists;
+
+    std::vector <void*> freeLists[ NUM_SIZE_CLASSES ];  // must be ACCESSED UNDER lockFreeLists !
+    size_t maxIdleMemory;                               // must be ACCESSED UNDER lockFreeLists !
+
+    std::atomic <size_t> memoryInUse;
+    std::atomic <size_t> idleMemory;
+};
+
+}
+}
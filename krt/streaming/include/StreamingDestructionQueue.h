@@ -0,0 +1,74 @@
+#pragma once
+
+// Deferred destruction of the objects of unloaded resources.
+// Destroying big objects (like models with all their geometry) can take a while, so streaming types
+// can queue it instead of doing it while unloading. The queue is run with a time budget (like once per frame)
+// or by a background thread, so that big unload waves are spread out instead of stalling anybody.
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace krt
+{
+namespace streaming
+{
+
+struct StreamingDestructionQueue
+{
+    typedef std::function <void ( void )> destructor_t;
+
+    StreamingDestructionQueue( void );
+
+    // Stops the background thread and runs whatever is left.
+    ~StreamingDestructionQueue( void );
+
+    // THREAD-SAFE. The memory size is only kept for statistics.
+    void Push( destructor_t destructor, size_t memorySize );
+
+    // THREAD-SAFE. Runs queued destructors in order until the time budget (in microseconds) is used up.
+    // At least one destructor is run, so that the queue keeps moving even if single destructors take long.
+    // Returns the amount of destructors that were run.
+    size_t Run( unsigned long long timeBudget );
+
+    // THREAD-SAFE. Runs destructors until the queue is empty, including ones that are queued in the meantime.
+    void RunAll( void );
+
+    // THREAD-SAFE. The background thread runs destructors as soon as they are queued.
+    // Only enable it if the objects can be destroyed on any thread.
+    void SetBackgroundThread( bool isEnabled );
+
+    inline size_t GetNumPending( void ) const       { return this->numPending; }
+    inline size_t GetPendingMemory( void ) const    { return this->pendingMemory; }
+
+private:
+    bool RunNext( void );
+
+    void BackgroundThreadRuntime( void );
+
+    struct entry_t
+    {
+        destructor_t destructor;
+        size_t memorySize;
+    };
+
+    mutable std::mutex lockQueue;
+
+    std::deque <entry_t> entries;           // must be ACCESSED UNDER lockQueue !
+    bool isThreadTerminating;               // must be ACCESSED UNDER lockQueue !
+
+    std::condition_variable condQueueUpdate;
+    // notified when destructors are queued (uses lockQueue).
+
+    std::mutex lockThread;
+    std::thread backgroundThread;           // must be ACCESSED UNDER lockThread !
+
+    std::atomic <size_t> numPending;        // includes destructors that are being run.
+    std::atomic <size_t> pendingMemory;
+};
+
+}
+}
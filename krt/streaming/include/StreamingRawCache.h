@@ -0,0 +1,90 @@
+#pragma once
+
+// Second tier of the streaming system.
+// Keeps the raw data of resources in memory under its own budget, so that resources which have
+// been evicted can be loaded again without going back to the device. The data can be compressed
+// to fit more resources into the budget, at the cost of some time on the streaming threads.
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace krt
+{
+namespace streaming
+{
+
+typedef int ident_t;
+
+struct StreamingRawCache
+{
+    StreamingRawCache( void );
+
+    // THREAD-SAFE. Keeps a copy of the data of a resource, unless it is cached already.
+    // The data has to stay the same for as long as the resource is linked.
+    void Store( ident_t id, const void *data, size_t dataSize );
+
+    // THREAD-SAFE. Writes the cached data into dataBuf.
+    // Returns false if the resource is not cached, then dataBuf has not been touched.
+    bool Fetch( ident_t id, void *dataBuf, size_t dataSize );
+
+    // THREAD-SAFE.
+    bool Contains( ident_t id ) const;
+
+    // THREAD-SAFE. Marks the data of a resource as recently used, so that it is kept the longest.
+    void Touch( ident_t id );
+
+    // THREAD-SAFE. Has to be called once the data of a resource is not valid anymore.
+    void Remove( ident_t id );
+
+    // THREAD-SAFE. Pass zero to disable the cache, which drops everything in it.
+    // Changing the compression only affects data that is stored from then on.
+    void SetMaxMemory( size_t maxMemory );
+    void SetCompression( bool isCompressing );
+
+    void ResetStatistics( void );
+
+    inline bool IsEnabled( void ) const         { return ( this->maxMemory != 0 ); }
+
+    inline size_t GetMaxMemory( void ) const    { return this->maxMemory; }
+    inline size_t GetMemoryInUse( void ) const  { return this->memoryInUse; }
+    inline size_t GetRawDataSize( void ) const  { return this->rawDataSize; }
+    inline size_t GetNumHits( void ) const      { return this->numHits; }
+    inline size_t GetNumMisses( void ) const    { return this->numMisses; }
+
+private:
+    typedef std::shared_ptr <const std::vector <unsigned char>> data_t;
+
+    struct entry_t
+    {
+        data_t data;        // shared, so that it can be decompressed without holding the lock.
+        size_t dataSize;    // size of the data once it is decompressed.
+        bool isCompressed;
+
+        std::list <ident_t>::iterator lruNode;
+    };
+
+    // only THREAD-SAFE if called from lockEntries !
+    void RemoveEntryNoLock( std::unordered_map <ident_t, entry_t>::iterator iter );
+    void TrimNoLock( size_t maxMemory );
+
+    mutable std::mutex lockEntries;
+
+    std::unordered_map <ident_t, entry_t> entries;  // must be ACCESSED UNDER lockEntries !
+    std::list <ident_t> lruList;                    // least recently used first, must be ACCESSED UNDER lockEntries !
+
+    std::atomic <size_t> maxMemory;
+    std::atomic <bool> isCompressing;
+
+    std::atomic <size_t> memoryInUse;   // what the cached data takes up.
+    std::atomic <size_t> rawDataSize;   // what the cached data would take up without compression.
+
+    std::atomic <size_t> numHits;
+    std::atomic <size_t> numMisses;
+};
+
+}
+}
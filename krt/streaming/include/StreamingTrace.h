@@ -0,0 +1,75 @@
+#pragma once
+
+// Binary traces of the streaming system.
+// A trace holds everything the runtime asked the streaming system for, together with how long
+// loads took, so that a session can be replayed without the game (see StreamMan::StartTrace).
+
+#include <functional>
+#include <vector>
+
+namespace krt
+{
+namespace streaming
+{
+
+typedef int ident_t;
+
+// A trace is just a sequence of these, in the byte order of the recording machine.
+struct StreamingTraceRecord
+{
+    static const unsigned int VERSION = 1;
+
+    enum class eType : unsigned int
+    {
+        BEGIN,              // args: VERSION, channel count, I/O worker count.
+        SET_MAX_MEMORY,     // args: low and high 32 bits of the budget.
+        REGISTER_TYPE,      // id is the base, args: range.
+        UNREGISTER_TYPE,    // id is the base.
+        LINK,               // args: data size.
+        UNLINK,
+        ADD_DEPENDENCY,     // args: ident that is depended on.
+        REMOVE_DEPENDENCY,  // args: ident that is depended on.
+        RESIDENT,           // was already loaded when the trace started.
+        REQUEST,            // args: priority (bits of the float), 1 if a ticket was asked for.
+        UNLOAD,
+        CANCEL,
+        QUERY_STATUS,       // args: the returned StreamMan::eResourceStatus.
+        LOADING_BARRIER,
+        LOADED,             // args: queue wait, I/O and decode time in microseconds, resident size.
+        FAILED,
+        UNLOADED
+    };
+
+    eType type;
+    ident_t id;
+    unsigned long long time;    // microseconds since the trace was started.
+    unsigned int args[ 4 ];
+};
+
+static_assert( sizeof( StreamingTraceRecord ) == 32, "trace records must stay compact" );
+
+// Collects records and hands them to a writer in big chunks.
+// NOT THREAD-SAFE, the StreamMan serializes access to it.
+struct StreamingTraceRecorder
+{
+    typedef std::function <void ( const void *data, size_t dataSize )> writer_t;
+
+    StreamingTraceRecorder( writer_t writer );
+    ~StreamingTraceRecorder( void );
+
+    void Record( StreamingTraceRecord::eType type, ident_t id, unsigned int arg0 = 0, unsigned int arg1 = 0, unsigned int arg2 = 0, unsigned int arg3 = 0 );
+
+    void Flush( void );
+
+private:
+    static const size_t MAX_BUFFERED_RECORDS = 4096;
+
+    writer_t writer;
+
+    unsigned long long startTime;
+
+    std::vector <StreamingTraceRecord> records;
+};
+
+}
+}
@@ -12,13 +12,67 @@ namespace streaming
 using vfs::Device;
 using vfs::DevicePtr;
 
+static inline char ToLowerASCII(char c)
+{
+	return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// entry names only end with a zero if they are shorter than the name field
+template <size_t nameSize>
+static inline size_t GetEntryNameLength(const char (&name)[nameSize])
+{
+	const char* nameEnd = static_cast<const char*>(memchr(name, 0, nameSize));
+
+	return (nameEnd) ? static_cast<size_t>(nameEnd - name) : nameSize;
+}
+
+// FNV-1a over the lower case name
+static inline uint32_t HashEntryName(const char* name, size_t nameLength)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < nameLength; i++)
+	{
+		hash ^= static_cast<uint8_t>(ToLowerASCII(name[i]));
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static inline bool EntryNameEquals(const char* left, const char* right, size_t nameLength)
+{
+	for (size_t i = 0; i < nameLength; i++)
+	{
+		if (ToLowerASCII(left[i]) != ToLowerASCII(right[i]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
 CdImageDevice::CdImageDevice()
-    : m_parentHandle(InvalidHandle)
+    : m_parentHandle(InvalidHandle), m_mappedImage(nullptr), m_mappedLength(0), m_numHandleSlots(0), m_freeHandles(0)
 {
+	for (auto& chunk : m_handleChunks)
+	{
+		chunk = nullptr;
+	}
+
 }
 
 CdImageDevice::~CdImageDevice()
 {
+	// views that were handed out point into the mapping, so it lives as long as we do
+	if (m_mappedImage)
+	{
+		m_parentDevice->UnmapBulk(m_mappedImage, m_mappedLength);
+
+		m_mappedImage = nullptr;
+	}
+
 	// close the parent device if needed
 	if (m_parentHandle != InvalidHandle)
 	{
@@ -26,9 +80,14 @@ CdImageDevice::~CdImageDevice()
 
 		m_parentHandle = InvalidHandle;
 	}
+
+	for (auto& chunk : m_handleChunks)
+	{
+		delete[] chunk.load();
+	}
 }
 
-bool CdImageDevice::OpenImage(const std::string& imagePath)
+bool CdImageDevice::OpenImage(const std::string& imagePath, bool mapImage)
 {
 	exclusive_lock_acquire<std::shared_timed_mutex> ctxOpenOp(this->lockDeviceConsistency);
 
@@ -105,59 +164,243 @@ bool CdImageDevice::OpenImage(const std::string& imagePath)
 	}
 
 	// calculate the entry hash map
-	for (auto& entry : m_entries)
-	{
-		m_entryLookup[entry.name] = &entry;
-	}
+	BuildEntryLookup();
 
-	// close the directory and return a success value
+	// close the directory
 	parentDevice->CloseBulk(directoryHandle);
 
+	// map the image if wanted, we keep reading through the parent device if that does not work (like without enough address space)
+	if (mapImage)
+	{
+		size_t imageLength = parentDevice->GetLength(imagePath);
+
+		if (imageLength != -1 && imageLength != 0)
+		{
+			m_mappedImage = static_cast<const uint8_t*>(parentDevice->MapBulk(m_parentHandle, m_parentPtr, imageLength));
+
+			if (m_mappedImage)
+			{
+				m_mappedLength = imageLength;
+			}
+		}
+	}
+
 	return true;
 }
 
+// only THREAD-SAFE if called from at least SHARED-LOCK.
+size_t CdImageDevice::ReadImage(uint64_t ptr, void* outBuffer, size_t size)
+{
+	// mapped images are copied straight from memory
+	if (m_mappedImage)
+	{
+		if (ptr >= m_mappedLength)
+		{
+			return 0;
+		}
+
+		size_t toCopy = std::min(size, static_cast<size_t>(m_mappedLength - ptr));
+
+		memcpy(outBuffer, m_mappedImage + ptr, toCopy);
+
+		return toCopy;
+	}
+
+	return m_parentDevice->ReadBulk(m_parentHandle, m_parentPtr + ptr, outBuffer, size);
+}
+
+// only THREAD-SAFE if called from EXCLUSIVE-LOCK.
+void CdImageDevice::BuildEntryLookup()
+{
+	// keep the table at most half full, so that probing stays short
+	size_t numSlots = 16;
+
+	while (numSlots < (m_entries.size() * 2))
+	{
+		numSlots *= 2;
+	}
+
+	LookupSlot freeSlot;
+	freeSlot.hash       = 0;
+	freeSlot.entryIndex = InvalidEntryIndex;
+
+	m_entryLookup.assign(numSlots, freeSlot);
+
+	size_t slotMask = (numSlots - 1);
+
+	for (size_t entryIndex = 0; entryIndex < m_entries.size(); entryIndex++)
+	{
+		const Entry& entry = m_entries[entryIndex];
+
+		size_t nameLength = GetEntryNameLength(entry.name);
+		uint32_t hash     = HashEntryName(entry.name, nameLength);
+
+		for (size_t slotIndex = (hash & slotMask);; slotIndex = ((slotIndex + 1) & slotMask))
+		{
+			LookupSlot& slot = m_entryLookup[slotIndex];
+
+			if (slot.entryIndex == InvalidEntryIndex)
+			{
+				slot.hash       = hash;
+				slot.entryIndex = static_cast<uint32_t>(entryIndex);
+				break;
+			}
+
+			// if a name is in the image more than once, the last entry wins
+			const Entry& otherEntry = m_entries[slot.entryIndex];
+
+			if (slot.hash == hash && GetEntryNameLength(otherEntry.name) == nameLength && EntryNameEquals(otherEntry.name, entry.name, nameLength))
+			{
+				slot.entryIndex = static_cast<uint32_t>(entryIndex);
+				break;
+			}
+		}
+	}
+}
+
+// only THREAD-SAFE if called from SHARED-LOCK.
+const CdImageDevice::Entry* CdImageDevice::LookupEntry(const char* name, size_t nameLength) const
+{
+	// names that do not fit into an entry cannot be in the image
+	if (m_entryLookup.empty() || nameLength > sizeof(Entry::name))
+	{
+		return nullptr;
+	}
+
+	uint32_t hash   = HashEntryName(name, nameLength);
+	size_t slotMask = (m_entryLookup.size() - 1);
+
+	for (size_t slotIndex = (hash & slotMask);; slotIndex = ((slotIndex + 1) & slotMask))
+	{
+		const LookupSlot& slot = m_entryLookup[slotIndex];
+
+		if (slot.entryIndex == InvalidEntryIndex)
+		{
+			return nullptr;
+		}
+
+		if (slot.hash == hash)
+		{
+			const Entry& entry = m_entries[slot.entryIndex];
+
+			if (GetEntryNameLength(entry.name) == nameLength && EntryNameEquals(entry.name, name, nameLength))
+			{
+				return &entry;
+			}
+		}
+	}
+}
+
 // only THREAD-SAFE if called from SHARED-LOCK.
 const CdImageDevice::Entry* CdImageDevice::FindEntry(const std::string& path) const
 {
-	// remove the path prefix
-	std::string relativePath = path.substr(m_pathPrefix.length());
+	size_t prefixLength = m_pathPrefix.length();
+
+	if (path.length() < prefixLength)
+	{
+		return nullptr;
+	}
 
-	// then, look up the entry in the lookup table
-	const auto it = m_entryLookup.find(relativePath);
+	// look up the path without the prefix in place, so that nothing has to be allocated
+	return LookupEntry(path.c_str() + prefixLength, path.length() - prefixLength);
+}
+
+// THREAD-SAFE, chunks are only ever added until the device is gone.
+CdImageDevice::HandleData* CdImageDevice::GetHandleSlot(uint32_t index)
+{
+	// chunk n starts at FirstHandleChunkSize * (2^n - 1)
+	uint32_t chunkIndex = 0;
+
+	while ((index / FirstHandleChunkSize + 1) >> (chunkIndex + 1))
+	{
+		chunkIndex++;
+	}
 
-	// if not found, return such
-	if (it == m_entryLookup.end())
+	if (chunkIndex >= MaxHandleChunks)
 	{
 		return nullptr;
 	}
 
-	// otherwise, return the entry
-	return it->second;
+	uint32_t chunkStart = FirstHandleChunkSize * ((1u << chunkIndex) - 1);
+
+	HandleData* chunk = m_handleChunks[chunkIndex].load(std::memory_order_acquire);
+
+	if (!chunk)
+	{
+		HandleData* newChunk = new HandleData[FirstHandleChunkSize << chunkIndex];
+
+		// somebody else could have been faster
+		if (m_handleChunks[chunkIndex].compare_exchange_strong(chunk, newChunk, std::memory_order_acq_rel))
+		{
+			chunk = newChunk;
+		}
+		else
+		{
+			delete[] newChunk;
+		}
+	}
+
+	return &chunk[index - chunkStart];
 }
 
-// only THREAD-SAFE if called from EXCLUSIVE-LOCK.
+// THREAD-SAFE, the handle is not valid until the caller says so.
 CdImageDevice::HandleData* CdImageDevice::AllocateHandle(THandle* outHandle)
 {
-	for (int i = 0; i < _countof(m_handles); i++)
+	uint64_t freeHandles = m_freeHandles.load(std::memory_order_acquire);
+
+	// reuse a closed handle if there is one
+	while (uint32_t freeIndex = static_cast<uint32_t>(freeHandles))
 	{
-		if (!m_handles[i].valid)
+		HandleData* handleData = GetHandleSlot(freeIndex - 1);
+
+		// the tag makes sure that the head has not been taken and put back in the meantime
+		uint64_t newFreeHandles = ((freeHandles >> 32) + 1) << 32 | handleData->nextFree.load(std::memory_order_relaxed);
+
+		if (m_freeHandles.compare_exchange_weak(freeHandles, newFreeHandles, std::memory_order_acq_rel))
 		{
-			*outHandle = i;
+			*outHandle = freeIndex - 1;
 
-			return &m_handles[i];
+			return handleData;
 		}
 	}
 
-	return nullptr;
+	// otherwise take a new one
+	uint32_t index = m_numHandleSlots.fetch_add(1);
+
+	HandleData* handleData = GetHandleSlot(index);
+
+	if (handleData)
+	{
+		*outHandle = index;
+	}
+
+	return handleData;
 }
 
+// THREAD-SAFE, if the handle is only closed once.
+void CdImageDevice::FreeHandle(HandleData* handleData, THandle handle)
+{
+	uint64_t freeHandles = m_freeHandles.load(std::memory_order_relaxed);
+	uint64_t newFreeHandles;
+
+	do
+	{
+		handleData->nextFree.store(static_cast<uint32_t>(freeHandles), std::memory_order_relaxed);
+
+		newFreeHandles = ((freeHandles >> 32) + 1) << 32 | static_cast<uint32_t>(handle + 1);
+	} while (!m_freeHandles.compare_exchange_weak(freeHandles, newFreeHandles, std::memory_order_release, std::memory_order_relaxed));
+}
+
+// THREAD-SAFE.
 CdImageDevice::HandleData* CdImageDevice::GetHandle(THandle inHandle)
 {
-	if (inHandle >= 0 && inHandle < _countof(m_handles))
+	if (inHandle < m_numHandleSlots.load(std::memory_order_acquire))
 	{
-		if (m_handles[inHandle].valid)
+		HandleData* handleData = GetHandleSlot(static_cast<uint32_t>(inHandle));
+
+		if (handleData && handleData->valid.load(std::memory_order_acquire))
 		{
-			return &m_handles[inHandle];
+			return handleData;
 		}
 	}
 
@@ -166,7 +409,8 @@ CdImageDevice::HandleData* CdImageDevice::GetHandle(THandle inHandle)
 
 CdImageDevice::THandle CdImageDevice::Open(const std::string& fileName, bool readOnly)
 {
-	exclusive_lock_acquire<std::shared_timed_mutex> ctxOpenImageHandle(this->lockDeviceConsistency);
+	// handles are allocated by themselves, so we only need the entries to stay the same.
+	shared_lock_acquire<std::shared_timed_mutex> ctxOpenImageHandle(this->lockDeviceConsistency);
 
 	// we only support read-only files
 	if (readOnly)
@@ -182,10 +426,11 @@ CdImageDevice::THandle CdImageDevice::Open(const std::string& fileName, bool rea
 
 			if (handleData)
 			{
-				handleData->valid     = true;
 				handleData->entry     = *entry;
 				handleData->curOffset = 0;
 
+				handleData->valid.store(true, std::memory_order_release);
+
 				return handle;
 			}
 		}
@@ -212,8 +457,8 @@ CdImageDevice::THandle CdImageDevice::OpenBulk(const std::string& fileName, uint
 
 size_t CdImageDevice::Read(THandle handle, void* outBuffer, size_t size)
 {
-	// EXLUSIVE LOCK IS REQUIRED, because you use a cached-handle approach.
-	exclusive_lock_acquire<std::shared_timed_mutex> ctxBulkOperations(this->lockDeviceConsistency);
+	// the offset belongs to the handle, so other readers can go on in the meantime.
+	shared_lock_acquire<std::shared_timed_mutex> ctxBulkOperations(this->lockDeviceConsistency);
 
 	auto handleData = GetHandle(handle);
 
@@ -233,10 +478,7 @@ size_t CdImageDevice::Read(THandle handle, void* outBuffer, size_t size)
 			toRead = size;
 		}
 
-		size_t didRead = m_parentDevice->ReadBulk(m_parentHandle,
-		                                          m_parentPtr + (handleData->entry.offset * CDIMAGE_SECTOR_SIZE) + handleData->curOffset,
-		                                          outBuffer,
-		                                          toRead);
+		size_t didRead = ReadImage((handleData->entry.offset * CDIMAGE_SECTOR_SIZE) + handleData->curOffset, outBuffer, toRead);
 
 		handleData->curOffset += didRead;
 
@@ -250,20 +492,55 @@ size_t CdImageDevice::ReadBulk(THandle handle, uint64_t ptr, void* outBuffer, si
 {
 	shared_lock_acquire<std::shared_timed_mutex> ctxBulkOperations(this->lockDeviceConsistency);
 
-	return m_parentDevice->ReadBulk(m_parentHandle, m_parentPtr + ptr, outBuffer, size);
+	return ReadImage(ptr, outBuffer, size);
 }
 
-bool CdImageDevice::Close(THandle handle)
+void CdImageDevice::ReadBulkAsync(THandle handle, uint64_t ptr, void* outBuffer, size_t size, const TReadCallback& callback)
 {
-	// Again, shared handle approach.
-	// We cannot let this go haywire.
-	exclusive_lock_acquire<std::shared_timed_mutex> ctxBulkOperations(this->lockDeviceConsistency);
+	size_t didRead;
+	{
+		shared_lock_acquire<std::shared_timed_mutex> ctxBulkOperations(this->lockDeviceConsistency);
+
+		if (!m_mappedImage)
+		{
+			m_parentDevice->ReadBulkAsync(m_parentHandle, m_parentPtr + ptr, outBuffer, size, callback);
+
+			return;
+		}
+
+		// mapped images are just copied
+		didRead = ReadImage(ptr, outBuffer, size);
+	}
+
+	callback(didRead);
+}
+
+const void* CdImageDevice::MapBulk(THandle handle, uint64_t ptr, size_t size)
+{
+	shared_lock_acquire<std::shared_timed_mutex> ctxBulkOperations(this->lockDeviceConsistency);
 
+	// only mapped images hand out views, mapping single entries is not worth it
+	if (!m_mappedImage || ptr > m_mappedLength || size > (m_mappedLength - ptr))
+	{
+		return nullptr;
+	}
+
+	return m_mappedImage + ptr;
+}
+
+void CdImageDevice::UnmapBulk(const void* view, size_t size)
+{
+	// views point into the mapping of the whole image, which is given back once we are gone
+}
+
+bool CdImageDevice::Close(THandle handle)
+{
 	auto handleData = GetHandle(handle);
 
-	if (handleData)
+	// only whoever marks the handle as closed gives it back
+	if (handleData && handleData->valid.exchange(false))
 	{
-		handleData->valid = false;
+		FreeHandle(handleData, handle);
 
 		return true;
 	}
@@ -276,10 +553,15 @@ bool CdImageDevice::CloseBulk(THandle handle)
 	return true;
 }
 
-size_t CdImageDevice::Seek(THandle handle, intptr_t offset, int seekType)
+bool CdImageDevice::IsBulkSpaceShared()
 {
-	exclusive_lock_acquire<std::shared_timed_mutex> ctxSeekHandle(this->lockDeviceConsistency);
+	// bulk pointers are offsets into the image, no matter which entry they were opened for
+	return true;
+}
 
+size_t CdImageDevice::Seek(THandle handle, intptr_t offset, int seekType)
+{
+	// the offset belongs to the handle, no lock needed.
 	auto handleData = GetHandle(handle);
 
 	if (handleData)
@@ -316,8 +598,7 @@ size_t CdImageDevice::Seek(THandle handle, intptr_t offset, int seekType)
 
 size_t CdImageDevice::GetLength(THandle handle)
 {
-	shared_lock_acquire<std::shared_timed_mutex> ctxImmutableOp(this->lockDeviceConsistency);
-
+	// the entry is copied into the handle, no lock needed.
 	auto handleData = GetHandle(handle);
 
 	if (handleData)
@@ -344,9 +625,8 @@ size_t CdImageDevice::GetLength(const std::string& fileName)
 
 CdImageDevice::THandle CdImageDevice::FindFirst(const std::string& folder, vfs::FindData* findData)
 {
-	// You are allocating some kind of handles, which is not thread-safe.
-	// So we gotta secure the device.
-	exclusive_lock_acquire<std::shared_timed_mutex> ctxScanningOperation(this->lockDeviceConsistency);
+	// handles are allocated by themselves, so we only need the entries to stay the same.
+	shared_lock_acquire<std::shared_timed_mutex> ctxScanningOperation(this->lockDeviceConsistency);
 
 	if (folder == m_pathPrefix)
 	{
@@ -358,7 +638,8 @@ CdImageDevice::THandle CdImageDevice::FindFirst(const std::string& folder, vfs::
 		    if (handleData)
 		    {
 			    handleData->curOffset = 0;
-			    handleData->valid     = true;
+
+			    handleData->valid.store(true, std::memory_order_release);
 
 			    FillFindData(findData, &m_entries[handleData->curOffset]);
 
@@ -372,7 +653,7 @@ CdImageDevice::THandle CdImageDevice::FindFirst(const std::string& folder, vfs::
 
 bool CdImageDevice::FindNext(THandle handle, vfs::FindData* findData)
 {
-	exclusive_lock_acquire<std::shared_timed_mutex> ctxScanningOperation(this->lockDeviceConsistency);
+	shared_lock_acquire<std::shared_timed_mutex> ctxScanningOperation(this->lockDeviceConsistency);
 
 	auto handleData = GetHandle(handle);
 
@@ -398,13 +679,11 @@ bool CdImageDevice::FindNext(THandle handle, vfs::FindData* findData)
 
 void CdImageDevice::FindClose(THandle handle)
 {
-	exclusive_lock_acquire<std::shared_timed_mutex> ctxScanningOperation(this->lockDeviceConsistency);
-
 	auto handleData = GetHandle(handle);
 
-	if (handleData)
+	if (handleData && handleData->valid.exchange(false))
 	{
-		handleData->valid = false;
+		FreeHandle(handleData, handle);
 	}
 }
 
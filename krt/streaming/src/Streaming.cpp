@@ -1,10 +1,35 @@
 #include "StdInc.h"
 #include "Streaming.h"
 
-#include <windows.h>
+#include <chrono>
+#include <cmath>
 
 #define STREAMING_DEFAULT_MAX_MEMORY            10000000 //meow
 
+// Upper limit of channels if the channel count is picked from the number of CPU cores.
+#define STREAMING_MAX_AUTO_CHANNELS             16
+
+// Queued loads of resources that are stored close to each other in the same bulk source
+// are taken together and read in as few requests as possible.
+#define STREAMING_BULK_MAX_REQUESTS             32
+#define STREAMING_BULK_MAX_SPAN                 ( 4 * 1024 * 1024 )
+#define STREAMING_BULK_MAX_GAP                  ( 64 * 1024 )   // reading over a gap is cheaper than seeking.
+
+// Limits of the I/O stage, so that reading ahead cannot run away from the channels.
+#define STREAMING_READ_AHEAD_MAX_LOADS          64
+#define STREAMING_READ_AHEAD_MAX_MEMORY         ( 8 * 1024 * 1024 )
+
+// Loads that an I/O worker reads at the same time, if they cannot be read together.
+#define STREAMING_READ_AHEAD_MAX_IN_FLIGHT      16
+
+// Buffers that are not in use are kept in the pool up to this size.
+#define STREAMING_BUFFER_POOL_MAX_IDLE_MEMORY   ( 16 * 1024 * 1024 )
+
+// Eviction starts once memory usage passes the high watermark and
+// stops once it has been brought down to the low watermark (in percent of maxMemory).
+#define STREAMING_EVICTION_HIGH_WATERMARK       90
+#define STREAMING_EVICTION_LOW_WATERMARK        75
+
 // NOTE that this is a very new system that needs ironing out bugs.
 // So report any issue that you can find!
 
@@ -13,6 +38,224 @@ namespace krt
 namespace streaming
 {
 
+// Time base of the telemetry, in microseconds.
+static inline unsigned long long GetStreamingTime( void )
+{
+    return (unsigned long long)std::chrono::duration_cast <std::chrono::microseconds> ( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+// Trace records only have room for 32 bits per argument.
+static inline unsigned int GetTraceArg( unsigned long long value )
+{
+    return (unsigned int)std::min( value, 0xFFFFFFFFull );
+}
+
+static inline unsigned int GetTraceFloatArg( float value )
+{
+    unsigned int bits;
+
+    memcpy( &bits, &value, sizeof( bits ) );
+
+    return bits;
+}
+
+// View of the data of a resource location, given back once it goes out of scope.
+struct dataView_t
+{
+    inline dataView_t( ResourceLocation *location ) : location( location ), dataView( NULL )
+    {
+        return;
+    }
+
+    inline ~dataView_t( void )
+    {
+        if ( this->dataView != NULL )
+        {
+            this->location->releaseDataView( this->dataView );
+        }
+    }
+
+    inline const void* Acquire( void )
+    {
+        this->dataView = this->location->acquireDataView();
+
+        return this->dataView;
+    }
+
+    inline bool IsValid( void ) const
+    {
+        return ( this->dataView != NULL );
+    }
+
+private:
+    ResourceLocation *location;
+    const void *dataView;
+};
+
+unsigned long long StreamingHistogram::GetPercentile( double fraction ) const
+{
+    if ( this->numSamples == 0 )
+        return 0;
+
+    unsigned long long wantedCount = (unsigned long long)std::ceil( fraction * (double)this->numSamples );
+
+    unsigned long long count = 0;
+
+    for ( size_t n = 0; n < NUM_BUCKETS; n++ )
+    {
+        count += this->buckets[ n ];
+
+        if ( count >= wantedCount )
+        {
+            // The last bucket is open ended.
+            if ( n == ( NUM_BUCKETS - 1 ) )
+                break;
+
+            return std::min( ( 1ull << n ), this->maxTime );
+        }
+    }
+
+    return this->maxTime;
+}
+
+StreamMan::latencyHistogram_t::latencyHistogram_t( void )
+{
+    Reset();
+}
+
+void StreamMan::latencyHistogram_t::Record( unsigned long long time )
+{
+    size_t bucketIdx = 0;
+
+    while ( bucketIdx < ( StreamingHistogram::NUM_BUCKETS - 1 ) && ( time >> bucketIdx ) != 0 )
+    {
+        bucketIdx++;
+    }
+
+    this->buckets[ bucketIdx ].fetch_add( 1, std::memory_order_relaxed );
+    this->numSamples.fetch_add( 1, std::memory_order_relaxed );
+    this->totalTime.fetch_add( time, std::memory_order_relaxed );
+
+    unsigned long long oldMax = this->maxTime.load( std::memory_order_relaxed );
+
+    while ( oldMax < time && this->maxTime.compare_exchange_weak( oldMax, time, std::memory_order_relaxed ) == false );
+}
+
+void StreamMan::latencyHistogram_t::Reset( void )
+{
+    for ( std::atomic <unsigned long long>& bucket : this->buckets )
+    {
+        bucket = 0;
+    }
+
+    this->numSamples = 0;
+    this->totalTime = 0;
+    this->maxTime = 0;
+}
+
+void StreamMan::latencyHistogram_t::GetSnapshot( StreamingHistogram& histogramOut ) const
+{
+    for ( size_t n = 0; n < StreamingHistogram::NUM_BUCKETS; n++ )
+    {
+        histogramOut.buckets[ n ] = this->buckets[ n ].load( std::memory_order_relaxed );
+    }
+
+    histogramOut.numSamples = this->numSamples.load( std::memory_order_relaxed );
+    histogramOut.totalTime = this->totalTime.load( std::memory_order_relaxed );
+    histogramOut.maxTime = this->maxTime.load( std::memory_order_relaxed );
+}
+
+RequestTicket::RequestTicket( ident_t id ) : id( id )
+{
+    this->isDone = false;
+    this->hasSucceeded = false;
+    this->hasRunCallbacks = false;
+}
+
+bool RequestTicket::IsDone( void ) const
+{
+    std::unique_lock <std::mutex> ctxCheckDone( this->lockCompletion );
+
+    return this->isDone;
+}
+
+bool RequestTicket::HasSucceeded( void ) const
+{
+    std::unique_lock <std::mutex> ctxCheckDone( this->lockCompletion );
+
+    return ( this->isDone && this->hasSucceeded );
+}
+
+bool RequestTicket::Wait( void ) const
+{
+    std::unique_lock <std::mutex> ctxWaitDone( this->lockCompletion );
+
+    this->condCompletion.wait( ctxWaitDone,
+        [&]
+    {
+        return this->hasRunCallbacks;
+    });
+
+    return this->hasSucceeded;
+}
+
+void RequestTicket::OnCompletion( callback_t callback )
+{
+    bool hasSucceeded = false;
+    {
+        std::unique_lock <std::mutex> ctxAddCallback( this->lockCompletion );
+
+        if ( this->isDone == false )
+        {
+            this->callbacks.push_back( std::move( callback ) );
+            return;
+        }
+
+        hasSucceeded = this->hasSucceeded;
+    }
+
+    // Finished already, so just call it.
+    callback( this->id, hasSucceeded );
+}
+
+void RequestTicket::Complete( bool hasSucceeded )
+{
+    std::vector <callback_t> callbacksToRun;
+    {
+        std::unique_lock <std::mutex> ctxComplete( this->lockCompletion );
+
+        // Can only finish once.
+        if ( this->isDone )
+            return;
+
+        this->isDone = true;
+        this->hasSucceeded = hasSucceeded;
+
+        callbacksToRun = std::move( this->callbacks );
+    }
+
+    for ( callback_t& callback : callbacksToRun )
+    {
+        try
+        {
+            callback( this->id, hasSucceeded );
+        }
+        catch( ... )
+        {
+            // The streaming system cannot do anything about errors of the runtime.
+        }
+    }
+
+    // Waiting people can rely on the callbacks having run.
+    {
+        std::unique_lock <std::mutex> ctxCallbacksDone( this->lockCompletion );
+
+        this->hasRunCallbacks = true;
+    }
+
+    this->condCompletion.notify_all();
+}
+
 void StreamMan::Channel::StreamingChannelRuntime( void *ud )
 {
     StreamMan *manager = NULL;
@@ -30,123 +273,272 @@ void StreamMan::Channel::StreamingChannelRuntime( void *ud )
     // TODO: add ERROR HANDLING to the streaming runtimes so that we can gracefully
     // stop loading things if they just cannot be.
 
-    while ( true )
+    // Sleep until there is something to do.
+    // We must not look at the other channels before the manager has finished spawning them,
+    // but nothing can be requested before that either.
+    while ( manager->NativeWaitForWork( channel ) )
     {
-        // Wait for requests to become available.
+        // Take a request and fulfill it!
+        // The activity is registered by the fetch, so that waiting people cannot miss it.
+        Channel::request_t request;
+        Channel::Activity *mainActivity = NULL;
+
+        if ( manager->NativeFetchRequest( channel, request, mainActivity ) == false )
         {
-            HANDLE waitHandles[] =
-            {
-                channel->terminationEvent,
-                channel->semRequestCount
-            };
+            // Somebody else was faster.
+            continue;
+        }
+
+        unsigned long long busyStartTime = GetStreamingTime();
+
+        if ( readAheadLoad_t *readLoad = channel->readAheadLoad )
+        {
+            // The I/O stage has read the data for us already.
+            channel->RunRequest( request, mainActivity, NULL, ( readLoad->hasData ? &readLoad->buffer : NULL ) );
 
-            DWORD waitResult = WaitForMultipleObjects( _countof(waitHandles), waitHandles, FALSE, INFINITE );
+            manager->NativeReleaseReadAhead( channel );
+        }
+        else if ( channel->batchedLoads.empty() )
+        {
+            channel->RunRequest( request, mainActivity, NULL, NULL );
+        }
+        else
+        {
+            // Resources that are stored next to each other are read in one go.
+            manager->NativeReadBatchedLoads( channel->batchedLoads, channel->batchBuffer );
 
-            if ( waitResult == WAIT_OBJECT_0 )
+            for ( const Channel::batchedLoad_t& batched : channel->batchedLoads )
             {
-                // Our thread termination event was signaled.
-                break;
+                channel->RunRequest( batched.request, batched.activity, batched.prefetchedData, NULL );
             }
+
+            channel->batchedLoads.clear();
+            channel->batchBuffer.Release();
         }
 
-        // Take a request and fulfill it!
-        Channel::Activity *mainActivity = NULL;
-        bool hasRequest = false;
-        Channel::request_t request;
-        {
-            std::unique_lock <std::mutex> ctxIsActiveUpdate( channel->lockIsActive );
-            std::unique_lock <std::mutex> ctxReqProcUpdate( channel->lockReqProcess );
+        channel->busyTime += ( GetStreamingTime() - busyStartTime );
+    }
 
-            exclusive_lock_acquire <std::shared_timed_mutex> ctxFetchRequest( channel->channelLock );
+    return;
+}
 
-            if ( channel->requests.empty() == false )
-            {
-                request = channel->requests.front();
+void StreamMan::Channel::RunRequest( const request_t& request, Activity *mainActivity, const void *prefetchedData, StreamingBuffer *prefetchedBuffer )
+{
+    StreamMan *manager = this->manager;
 
-                channel->requests.pop_front();
+    // We have to check whether this request makes any sense.
+    // Do that in a minimal verification phase.
+    // PLEASE NOTE THAT THIS IS A VERY COMPLICATED POINTER THAT COULD EASILY BREAK
+    // IF YOU DO NOT KNOW WHAT YOU ARE DOING.
+    Resource *resToLoad = NULL;
+    eRequestType reqType = request.reqType;
 
-                // We want to let the runtime know that we are doing something.
-                mainActivity = channel->AllocateActivity( request );
+    // Stays valid for as long as our activity is registered.
+    Resource *wantedResource = NULL;
 
-                hasRequest = true;
-            }
-        }
+    // Do not block this channel on dependencies that are not loaded yet.
+    // Other channels can load them while we do something else.
+    bool isParked = false;
 
-        // We have to check whether this request makes any sense.
-        // Do that in a minimal verification phase.
-        // PLEASE NOTE THAT THIS IS A VERY COMPLICATED POINTER THAT COULD EASILY BREAK
-        // IF YOU DO NOT KNOW WHAT YOU ARE DOING.
-        Resource *resToLoad = NULL;
-        eRequestType reqType = request.reqType;
+    if ( reqType == eRequestType::LOAD && request.isResumed == false )
+    {
+        isParked = manager->NativeParkLoad( request, prefetchedBuffer );
+    }
 
-        if ( hasRequest )
-        {
-            exclusive_lock_acquire <std::shared_timed_mutex> ctxResLoadAcquire( manager->lockResourceContest );
+    // Set if another channel is still letting go of the resource we want to load.
+    bool isContested = false;
+
+    // Set if the load has to continue once another resource has been processed.
+    bool isSuspended = false;
+    ident_t suspendedOn = -1;
 
-            Resource *wantedResource = manager->GetResourceAtID( request.resID );
+    {
+        exclusive_lock_acquire <std::shared_timed_mutex> ctxResLoadAcquire( manager->lockResourceContest );
+
+        wantedResource = manager->GetResourceAtID( request.resID );
+
+        if ( wantedResource && isParked == false )
+        {
+            bool isStaleEviction = false;
 
-            if ( wantedResource )
+            if ( request.isEviction )
             {
-                resToLoad = channel->AcquireResourceContext( wantedResource, request.reqType );
+                // The eviction could have been called off (like by unlinking the resource).
+                std::unique_lock <std::mutex> ctxEvictionState( manager->lockEviction );
+
+                isStaleEviction = ( wantedResource->isEvictionPending == false );
             }
-        }
 
-        if ( resToLoad )
-        {
-            try
+            if ( isStaleEviction == false )
             {
-                channel->ProcessResourceRequest( manager, resToLoad, reqType );
+                resToLoad = this->AcquireResourceContext( wantedResource, request.reqType );
             }
-            catch( ... )
+
+            // If the eviction cannot happen then the victim is not pending anymore.
+            if ( request.isEviction && resToLoad == NULL )
             {
-                // Oh no! We experienced a problem while processing one of our resource requests!
-                // How do we let the runtime even know about that? Will it recover?
-                // Welp, we hope that the programmer has been smart enough to think of such a case.
-                // We are just trying to cover our own ass, mostly.
+                manager->ClearEvictionPending( wantedResource );
+            }
 
-                // Do fault recovery.
-                manager->ResourceFaultRecovery( channel, resToLoad, reqType );
+            if ( resToLoad == NULL && reqType == eRequestType::LOAD && wantedResource->syncOwner != NULL )
+            {
+                eResourceStatus status = wantedResource->status;
 
-                // Just continue along.
+                if ( status == eResourceStatus::UNLOADED )
+                {
+                    // The owner has given up on the load (suspended, cancelled or failed) but not the resource yet.
+                    isContested = true;
+                }
+                else if ( status == eResourceStatus::UNLOADING )
+                {
+                    // The owner is still unloading, which can take a while.
+                    // Wait for it like for a dependency, it resumes us once it lets go of the resource.
+                    isSuspended = true;
+                    suspendedOn = request.resID;
+                }
             }
         }
+    }
+
+    // Try again once the other channel is done, so that this request is not lost.
+    if ( isContested )
+    {
+        manager->NativeRequeueLoad( wantedResource );
+    }
+
+    if ( resToLoad )
+    {
+        try
+        {
+            this->ProcessResourceRequest( manager, resToLoad, reqType, prefetchedData, prefetchedBuffer, true );
+        }
+        catch( const loadSuspension_t& suspension )
+        {
+            // Nothing has been given to the runtime yet.
+            resToLoad->status = eResourceStatus::UNLOADED;
+
+            isSuspended = true;
+            suspendedOn = suspension.waitForID;
+        }
+        catch( const loadCancellation_t& )
+        {
+            // Same here, so the resource just stays unloaded.
+            resToLoad->status = eResourceStatus::UNLOADED;
 
-        // Need to clear activity flag.
-        if ( hasRequest )
+            manager->numAbandonedLoads++;
+        }
+        catch( ... )
         {
-            // This is actually the counter part to acquiring a resource context.
+            // Oh no! We experienced a problem while processing one of our resource requests!
+            // How do we let the runtime even know about that? Will it recover?
+            // Welp, we hope that the programmer has been smart enough to think of such a case.
+            // We are just trying to cover our own ass, mostly.
 
-            std::unique_lock <std::mutex> ctxIsActiveUpdate( channel->lockIsActive );
-            std::unique_lock <std::mutex> ctxReqProcUpdate( channel->lockReqProcess );
+            // Do fault recovery.
+            manager->ResourceFaultRecovery( this, resToLoad, reqType );
 
-            exclusive_lock_acquire <std::shared_timed_mutex> ctxChannelConsistency( channel->channelLock );
+            // Just continue along.
+        }
+    }
 
-            // The resource is not being maintained anymore.
-            if ( resToLoad )
-            {
-                resToLoad->syncOwner = NULL;
-            }
+    // The eviction has happened (or failed), so the victim is not pending anymore.
+    // We still own the resource, so it cannot go away.
+    if ( resToLoad && request.isEviction )
+    {
+        manager->ClearEvictionPending( resToLoad );
+    }
+
+    // The resource is not being maintained anymore.
+    // This has to happen before parked loads are resumed, because they could want to take it over.
+    if ( resToLoad )
+    {
+        resToLoad->syncOwner = NULL;
+    }
+
+    // Set if this load goes on later, then it takes care of the tickets by itself.
+    bool isLoadGoingOn = isParked;
+
+    if ( isSuspended )
+    {
+        isLoadGoingOn = manager->NativeSuspendLoad( request, suspendedOn, prefetchedBuffer );
+    }
+
+    // The load has been acquired, queued again, parked or given up on by now, so it does not count as taken anymore.
+    // Doing that any earlier would let other channels think that nobody is loading the resource.
+    if ( reqType == eRequestType::LOAD && wantedResource )
+    {
+        std::unique_lock <std::mutex> ctxDropTakenLoad( manager->lockRequestQueue );
 
-            // We are not persuing our main goal anymore.
-            channel->DeallocateActivity( mainActivity );
+        assert( wantedResource->numTakenLoads != 0 );
+
+        wantedResource->numTakenLoads--;
+    }
+
+    // If nobody is going to load the resource anymore then its tickets can be completed.
+    // This happens for example if the request was superseded or if the resource is not allowed to load.
+    if ( wantedResource && isLoadGoingOn == false )
+    {
+        std::unique_lock <std::mutex> ctxCheckTickets( manager->lockTickets );
 
-            mainActivity = NULL;
+        eResourceStatus status = wantedResource->status;
 
-            // We are not active anymore if all requests are fulfilled.
-            if ( channel->requests.empty() == true )
+        if ( wantedResource->waitingTickets.empty() == false &&
+             status != eResourceStatus::BUFFERING && status != eResourceStatus::LOADING )
+        {
+            bool isLoadQueued = false;
             {
-                channel->isActive = false;
+                std::unique_lock <std::mutex> ctxCheckQueue( manager->lockRequestQueue );
 
-                // We can unlock any waiting people.
-                channel->condIsActive.notify_all();
+                isLoadQueued =
+                    ( wantedResource->queueIndex != Resource::NOT_QUEUED || wantedResource->isInReadStage ||
+                      wantedResource->isParked || wantedResource->numTakenLoads != 0 );
             }
 
-            // Notify some other people that a resource finished processing.
-            channel->condReqProcess.notify_all();
+            if ( isLoadQueued == false )
+            {
+                manager->NativeTakeTickets( wantedResource, ( status == eResourceStatus::LOADED ), this->finishedTickets );
+            }
         }
     }
 
-    return;
+    // Parked loads could be waiting for this resource.
+    if ( wantedResource && isParked == false && isSuspended == false )
+    {
+        manager->NativeResumeDependents( wantedResource );
+    }
+
+    // This is actually the counter part to acquiring a resource context.
+    {
+        std::unique_lock <std::mutex> ctxReqProcUpdate( this->lockReqProcess );
+
+        exclusive_lock_acquire <std::shared_timed_mutex> ctxChannelConsistency( this->channelLock );
+
+        // We are not persuing our main goal anymore.
+        this->DeallocateActivity( mainActivity );
+
+        mainActivity = NULL;
+
+        // Notify some other people that a resource finished processing.
+        this->condReqProcess.notify_all();
+    }
+
+    // Loading things could have pushed us over our memory budget.
+    // Do that before finishing the request so that loading barriers include the evictions.
+    if ( resToLoad && reqType == eRequestType::LOAD )
+    {
+        manager->EnforceMemoryBudget();
+    }
+
+    // The data is not needed anymore, so give it back before anybody thinks that we are done.
+    if ( prefetchedBuffer )
+    {
+        prefetchedBuffer->Release();
+    }
+
+    // We do not hold any locks anymore, so the callbacks of tickets can do whatever they want.
+    manager->NativeCompleteTickets( this->finishedTickets );
+
+    manager->NativeFinishRequest();
 }
 
 // only THREAD-SAFE if called from EXCLUSIVE-ACCESS at lockResourceContest !
@@ -154,6 +546,13 @@ StreamMan::Resource* StreamMan::Channel::AcquireResourceContext( Resource *wante
 {
     Resource *resToLoad = NULL;
 
+    // Owners update the status before they let go of the resource,
+    // so it can look like it is free while another channel still owns it.
+    if ( wantedResource->syncOwner != NULL )
+    {
+        return NULL;
+    }
+
     if ( reqType == eRequestType::LOAD )
     {
         // Who cares if we are terminating?
@@ -193,7 +592,6 @@ StreamMan::Resource* StreamMan::Channel::AcquireResourceContext( Resource *wante
     // The channel is basically a worker thread maintaining resources.
     if ( resToLoad )
     {
-        assert( resToLoad->syncOwner == NULL );
 
         resToLoad->syncOwner = this;
     }
@@ -201,8 +599,14 @@ StreamMan::Resource* StreamMan::Channel::AcquireResourceContext( Resource *wante
     return resToLoad;
 }
 
-void StreamMan::Channel::ProcessResourceRequest( StreamMan *manager, Resource *resToLoad, eRequestType reqType )
+void StreamMan::Channel::ProcessResourceRequest( StreamMan *manager, Resource *resToLoad, eRequestType reqType, const void *prefetchedData, StreamingBuffer *prefetchedBuffer, bool isCancellable )
 {
+    // Do not bother with the dependencies of loads that nobody wants anymore.
+    if ( isCancellable && reqType == eRequestType::LOAD && resToLoad->IsLoadCancelled() )
+    {
+        throw loadCancellation_t();
+    }
+
     // Make sure that our dependencies cannot unload.
     // This makes sense because dependencies are there to stay for as long as the resource lives.
     if ( reqType == eRequestType::LOAD )
@@ -234,31 +638,17 @@ void StreamMan::Channel::ProcessResourceRequest( StreamMan *manager, Resource *r
                     if ( status != eResourceStatus::LOADED )
                     {
                         // Take care of the problem that another channel could be taking the work from us.
-                        // Resources cannot be maintained infinitely by different channels, can they?
-                        // If they are, then the problem is in another component of the engine being faulty.
-                        while ( Channel *conflictingWorker = dependency->syncOwner )
+                        // Instead of sleeping until it has completed work, we suspend the whole load
+                        // and do something else. The load continues once the resource has been processed.
+                        if ( dependency->syncOwner != NULL )
                         {
-                            // If this resource is being maintained by another channel, we wait till it has completed work.
-
-                            // We can release this lock BECAUSE the resource dependencies are immutable
-                            // AND the resToLoad object cannot be destroyed while we manage it.
-                            manager->lockResourceContest.unlock();
-
-                            try
-                            {
-                                manager->NativeChannelWaitForResourceCompletion( conflictingWorker, dependency->id );
-                            }
-                            catch( ... )
-                            {
-                                manager->lockResourceContest.lock();
+                            loadSuspension_t suspension;
+                            suspension.waitForID = dependency->id;
 
-                                throw;
-                            }
-                                
-                            manager->lockResourceContest.lock();
+                            throw suspension;
                         }
 
-                        // Status of the resource could have changed!
+                        // The owner could have finished right before letting go, so look again.
                         status = dependency->status;
 
                         if ( status == eResourceStatus::UNLOADED )
@@ -269,7 +659,7 @@ void StreamMan::Channel::ProcessResourceRequest( StreamMan *manager, Resource *r
                             // If we could not get the context to the dependency, we cannot continue.
                             if ( dependToBeLoaded == NULL )
                             {
-                                throw std::exception( "failed to acquire context for loading resource dependencies" );
+                                throw std::runtime_error( "failed to acquire context for loading resource dependencies" );
                             }
 
                             try
@@ -277,8 +667,6 @@ void StreamMan::Channel::ProcessResourceRequest( StreamMan *manager, Resource *r
                                 // Register an activity about what we are doing.
                                 Activity *subActivity = NULL;
                                 {
-                                    std::unique_lock <std::mutex> ctxIsActiveUpdate( this->lockIsActive );
-
                                     exclusive_lock_acquire <std::shared_timed_mutex> ctxActivityUpdate( this->channelLock );
 
                                     request_t subRequest;
@@ -297,6 +685,15 @@ void StreamMan::Channel::ProcessResourceRequest( StreamMan *manager, Resource *r
                                         // Do the loading!
                                         ProcessResourceRequest( manager, dependToBeLoaded, eRequestType::LOAD );
                                     }
+                                    catch( const loadSuspension_t& )
+                                    {
+                                        // Nothing has been given to the runtime yet, so anybody can take over.
+                                        dependToBeLoaded->status = eResourceStatus::UNLOADED;
+
+                                        manager->lockResourceContest.lock();
+
+                                        throw;
+                                    }
                                     catch( ... )
                                     {
                                         // We seem to have failed explicitly the loading part.
@@ -314,14 +711,9 @@ void StreamMan::Channel::ProcessResourceRequest( StreamMan *manager, Resource *r
                                 {
                                     // We need to clean up the activity, because we failed for some reason.
                                     {
-                                        std::unique_lock <std::mutex> ctxIsActiveUpdate( this->lockIsActive );
-
                                         exclusive_lock_acquire <std::shared_timed_mutex> ctxActivityUpdate( this->channelLock );
 
                                         this->DeallocateActivity( subActivity );
-
-                                        // We finished some activity, so notify people.
-                                        this->condIsActive.notify_all();
                                     }
 
                                     throw;
@@ -329,17 +721,26 @@ void StreamMan::Channel::ProcessResourceRequest( StreamMan *manager, Resource *r
 
                                 // Unregister the sub activity again.
                                 {
-                                    std::unique_lock <std::mutex> ctxIsActiveUpdate( this->lockIsActive );
-
                                     exclusive_lock_acquire <std::shared_timed_mutex> ctxActivityUpdate( this->channelLock );
 
                                     this->DeallocateActivity( subActivity );
-
-                                    // We finished some activity, so notify people.
-                                    this->condIsActive.notify_all();
                                 }
                             }
-                            catch( ... )
+                            catch( const loadSuspension_t& )
+                            {
+                                {
+                                    assert( dependToBeLoaded->syncOwner == this );
+
+                                    dependToBeLoaded->syncOwner = NULL;
+                                }
+
+                                // Let the other channels load it while we are suspended.
+                                // Loads that are parked on it keep waiting for that.
+                                manager->NativeRequeueLoad( dependToBeLoaded );
+
+                                throw;
+                            }
+                            catch( ... )
                             {
                                 // Clean up sync ownership.
                                 {
@@ -348,6 +749,8 @@ void StreamMan::Channel::ProcessResourceRequest( StreamMan *manager, Resource *r
                                     dependToBeLoaded->syncOwner = NULL;
                                 }
 
+                                manager->NativeResumeDependents( dependToBeLoaded );
+
                                 throw;
                             }
 
@@ -357,6 +760,9 @@ void StreamMan::Channel::ProcessResourceRequest( StreamMan *manager, Resource *r
 
                                 dependToBeLoaded->syncOwner = NULL;
                             }
+
+                            // Parked loads could be waiting for this dependency too.
+                            manager->NativeResumeDependents( dependToBeLoaded );
                         }
                         else if ( status == eResourceStatus::LOADED )
                         {
@@ -367,7 +773,7 @@ void StreamMan::Channel::ProcessResourceRequest( StreamMan *manager, Resource *r
                             // No idea what kind of state this is...
                             assert( 0 );
 
-                            throw std::exception( "fatal error: unknown streaming system status" );
+                            throw std::runtime_error( "fatal error: unknown streaming system status" );
                         }
                     }
                 }
@@ -383,7 +789,7 @@ void StreamMan::Channel::ProcessResourceRequest( StreamMan *manager, Resource *r
         }
 
         // Load the main resource.
-        manager->NativeProcessStreamingRequest( reqType, this, resToLoad );
+        manager->NativeProcessStreamingRequest( reqType, this, resToLoad, prefetchedData, prefetchedBuffer, isCancellable );
     }
     catch( ... )
     {
@@ -417,6 +823,8 @@ void StreamMan::ResourceFaultRecovery( Channel *channel, Resource *faultyRes, Ch
 {
     // TODO: maybe add feedback about loading errors to the runtime.
 
+    this->numFaultRecoveries++;
+
     eResourceStatus resStatus = faultyRes->status;
 
     if ( reqType == Channel::eRequestType::LOAD )
@@ -424,8 +832,20 @@ void StreamMan::ResourceFaultRecovery( Channel *channel, Resource *faultyRes, Ch
         if ( resStatus == eResourceStatus::BUFFERING ||
              resStatus == eResourceStatus::LOADING )
         {
+            this->numFailedLoads++;
+
+            TraceEvent( StreamingTraceRecord::eType::FAILED, faultyRes->id );
+
             // We revert the status back to unloaded in both cases.
             faultyRes->status = eResourceStatus::UNLOADED;
+
+            // Let the waiting people know.
+            if ( channel )
+            {
+                std::unique_lock <std::mutex> ctxTakeTickets( this->lockTickets );
+
+                NativeTakeTickets( faultyRes, false, channel->finishedTickets );
+            }
         }
     }
     else if ( reqType == Channel::eRequestType::UNLOAD )
@@ -438,7 +858,22 @@ void StreamMan::ResourceFaultRecovery( Channel *channel, Resource *faultyRes, Ch
             faultyRes->status = eResourceStatus::UNLOADED;
 
             // Sanitarily decrease streaming memory.
-            this->totalStreamingMemoryUsage -= faultyRes->resourceSize;
+            this->totalStreamingMemoryUsage -= faultyRes->residentSize;
+
+            {
+                shared_lock_acquire <std::shared_timed_mutex> ctxTypeMemory( this->lockStreamingTypeMutate );
+
+                reg_streaming_type *typeInfo = this->GetStreamingTypeAtID( faultyRes->id );
+
+                if ( typeInfo )
+                {
+                    typeInfo->memoryInUse -= faultyRes->residentSize;
+                    typeInfo->numLoadedResources--;
+                }
+            }
+
+            // The type could still be using its data, but we cannot keep it forever.
+            faultyRes->retainedBuffer.Release();
         }
     }
     else
@@ -448,7 +883,7 @@ void StreamMan::ResourceFaultRecovery( Channel *channel, Resource *faultyRes, Ch
     }
 }
 
-void StreamMan::NativeProcessStreamingRequest( Channel::eRequestType reqType, Channel *loadingChannel, Resource *resToLoad )
+void StreamMan::NativeProcessStreamingRequest( Channel::eRequestType reqType, Channel *loadingChannel, Resource *resToLoad, const void *prefetchedData, StreamingBuffer *prefetchedBuffer, bool isCancellable )
 {
     ident_t resID = resToLoad->id;
 
@@ -470,33 +905,154 @@ void StreamMan::NativeProcessStreamingRequest( Channel::eRequestType reqType, Ch
             // We could have been called by just the streaming system during termination.
             assert( loadingChannel != NULL );
 
-            // Request a private buffer from the channel.
-            void *dataBuffer = loadingChannel->GetStreamingBuffer( resourceSize );
+            // Buffer that we own, so that the streaming type can keep it.
+            StreamingBuffer readBuffer;
+
+            // Data that the location lets us use in place, given back once we are done.
+            dataView_t dataView( resToLoad->location );
+
+            const void *dataBuffer = prefetchedData;
+
+            if ( dataBuffer == NULL )
+            {
+                if ( prefetchedBuffer && prefetchedBuffer->IsValid() )
+                {
+                    readBuffer = std::move( *prefetchedBuffer );
+
+                    dataBuffer = readBuffer.GetData();
+                }
+                else
+                {
+                    if ( isCancellable && resToLoad->IsLoadCancelled() )
+                    {
+                        throw Channel::loadCancellation_t();
+                    }
+
+                    unsigned long long ioStartTime = GetStreamingTime();
+
+                    dataBuffer = dataView.Acquire();
+
+                    if ( dataBuffer != NULL )
+                    {
+                        resToLoad->ioTime.store( GetStreamingTime() - ioStartTime, std::memory_order_relaxed );
+                    }
+                    else
+                    {
+                        readBuffer = this->bufferPool.Allocate( resourceSize );
+
+                        // Load this resource.
+                        NativeFetchResourceData( resToLoad, readBuffer.GetData() );
+
+                        dataBuffer = readBuffer.GetData();
+                    }
+                }
+            }
+
+            // Last chance to call it off.
+            if ( isCancellable && resToLoad->IsLoadCancelled() )
+            {
+                throw Channel::loadCancellation_t();
+            }
+
+            // Keep the data around for when the resource is loaded again.
+            // Mapped data does not need that, it stays in memory anyway.
+            if ( dataView.IsValid() == false )
+            {
+                this->rawCache.Store( resID, dataBuffer, resourceSize );
+            }
+
+            bool keepsData = streamingType->KeepsResourceData();
 
-            // Load this resource.
-            resToLoad->location->fetchData( dataBuffer );
+            if ( keepsData && readBuffer.IsValid() == false )
+            {
+                // The data is shared with other resources, so the type needs its own copy.
+                readBuffer = this->bufferPool.Allocate( resourceSize );
+
+                memcpy( readBuffer.GetData(), dataBuffer, resourceSize );
+
+                dataBuffer = readBuffer.GetData();
+            }
 
             // Transition state from BUFFERING to LOADING.
             resToLoad->status = eResourceStatus::LOADING;
 
+            unsigned long long decodeStartTime = GetStreamingTime();
+
             // Give this data to the runtime.
             streamingType->LoadResource( localID, dataBuffer, resourceSize );
 
+            unsigned long long decodeTime = ( GetStreamingTime() - decodeStartTime );
+
+            // The type uses the data in place, so it has to stay around while we are loaded.
+            // Otherwise the buffer goes back to the pool right away.
+            if ( keepsData )
+            {
+                resToLoad->retainedBuffer = std::move( readBuffer );
+            }
+
+            // Count what the resource really takes up, not just the size of its data.
+            size_t residentSize = streamingType->GetObjectMemorySize( localID );
+
+            if ( keepsData )
+            {
+                residentSize += resourceSize;
+            }
+
+            if ( residentSize == 0 )
+            {
+                residentSize = resourceSize;
+            }
+
+            resToLoad->residentSize = residentSize;
+
             // We are now loaded!
             resToLoad->status = eResourceStatus::LOADED;
 
-            this->totalStreamingMemoryUsage += resourceSize;
+            this->totalStreamingMemoryUsage += residentSize;
+
+            typeInfo->memoryInUse += residentSize;
+            typeInfo->numLoadedResources++;
+
+            // Tell where the time went.
+            unsigned long long queueWaitTime = resToLoad->queueWaitTime.exchange( 0, std::memory_order_relaxed );
+            unsigned long long ioTime = resToLoad->ioTime.exchange( 0, std::memory_order_relaxed );
+
+            typeInfo->queueWaitTime.Record( queueWaitTime );
+            typeInfo->ioTime.Record( ioTime );
+            typeInfo->decodeTime.Record( decodeTime );
+
+            TraceEvent( StreamingTraceRecord::eType::LOADED, resID, GetTraceArg( queueWaitTime ), GetTraceArg( ioTime ), GetTraceArg( decodeTime ), GetTraceArg( residentSize ) );
+
+            loadingChannel->bytesLoaded += resourceSize;
+
+            // The channel completes the tickets once it is done with the request.
+            {
+                std::unique_lock <std::mutex> ctxTakeTickets( this->lockTickets );
+
+                NativeTakeTickets( resToLoad, true, loadingChannel->finishedTickets );
+            }
         }
         else if ( reqType == Channel::eRequestType::UNLOAD )
         {
             // Just unload this crap.
             streamingType->UnloadResource( localID );
 
+            // Nobody is using the data anymore.
+            resToLoad->retainedBuffer.Release();
+
             // We are not loaded anymore, meow.
-            this->totalStreamingMemoryUsage -= resourceSize;
+            this->totalStreamingMemoryUsage -= resToLoad->residentSize;
+
+            typeInfo->memoryInUse -= resToLoad->residentSize;
+            typeInfo->numLoadedResources--;
 
             // Unloaded :)
             resToLoad->status = eResourceStatus::UNLOADED;
+
+            // Recently evicted resources are the most likely to be wanted again.
+            this->rawCache.Touch( resID );
+
+            TraceEvent( StreamingTraceRecord::eType::UNLOADED, resID );
         }
         else
         {
@@ -505,7 +1061,7 @@ void StreamMan::NativeProcessStreamingRequest( Channel::eRequestType reqType, Ch
     }
 }
 
-StreamMan::Channel::Channel( StreamMan *manager )
+StreamMan::Channel::Channel( StreamMan *manager, unsigned int channelIndex ) : channelIndex( channelIndex )
 {
     this->manager = manager;
 
@@ -513,11 +1069,10 @@ StreamMan::Channel::Channel( StreamMan *manager )
     params->manager = manager;
     params->channel = this;
 
-    // Semaphore for request availability.
-    this->semRequestCount = CreateSemaphoreW( NULL, 0, 9000, NULL );
-    this->terminationEvent = CreateEventW( NULL, TRUE, FALSE, NULL );
-
-    this->isActive = false;
+    this->isTerminating = false;
+    this->readAheadLoad = NULL;
+    this->bytesLoaded = 0;
+    this->busyTime = 0;
 
     LIST_CLEAR( this->activities.root );
 
@@ -530,29 +1085,57 @@ StreamMan::Channel::Channel( StreamMan *manager )
 StreamMan::Channel::~Channel( void )
 {
     // Wait for thread termination.
-    SetEvent(terminationEvent);
+    this->isTerminating = true;
 
-    this->thread.join();
+    WaitForTermination();
 
     assert( LIST_EMPTY( this->activities.root ) == true );
+}
 
-    assert( this->isActive == false );
-
-    // Clean up management stuff.
-    CloseHandle( this->semRequestCount );
-    CloseHandle( this->terminationEvent );
+void StreamMan::Channel::WaitForTermination( void )
+{
+    if ( this->thread.joinable() )
+    {
+        this->thread.join();
+    }
 }
 
-StreamMan::StreamMan( unsigned int numChannels ) : totalStreamingMemoryUsage( 0 ), maxMemory( STREAMING_DEFAULT_MAX_MEMORY )
+StreamMan::StreamMan( unsigned int numChannels, unsigned int numIOWorkers ) : bufferPool( STREAMING_BUFFER_POOL_MAX_IDLE_MEMORY ), maxMemory( STREAMING_DEFAULT_MAX_MEMORY ), totalStreamingMemoryUsage( 0 ), useClock( 0 ), pendingEvictionMemory( 0 )
 {
     // Initialize management variables.
-    this->currentChannelID = 0;
     this->isTerminating = false;
+    this->numQueuedRequests = 0;
+    this->numOutstandingRequests = 0;
+    this->numIdleChannels = 0;
+    this->readStageMemory = 0;
+    this->numParkedLoads = 0;
+    this->numCancelledRequests = 0;
+    this->numAbandonedLoads = 0;
+    this->numFailedLoads = 0;
+    this->numFaultRecoveries = 0;
+    this->isTracing = false;
+
+    if ( numChannels == 0 )
+    {
+        // Leave one core to the main thread.
+        unsigned int numCores = std::thread::hardware_concurrency();
+
+        numChannels = std::min( std::max( numCores, 2u ) - 1, (unsigned int)STREAMING_MAX_AUTO_CHANNELS );
+    }
 
     // Spawn channels for loading.
     for ( unsigned int n = 0; n < numChannels; n++ )
     {
-        this->channels.push_back( new Channel( this ) );
+        this->channels.push_back( new Channel( this, n ) );
+    }
+
+    // Spawn the I/O stage.
+    for ( unsigned int n = 0; n < numIOWorkers; n++ )
+    {
+        this->ioWorkers.push_back( std::thread( [this] ()
+        {
+            NativeIOWorkerRuntime();
+        }));
     }
 }
 
@@ -561,9 +1144,45 @@ StreamMan::~StreamMan( void )
     // Prevent anything from loading anymore.
     this->isTerminating = true;
 
+    // Whatever happens from now on is not worth replaying.
+    StopTrace();
+
+    // Stop the I/O stage.
+    {
+        {
+            std::unique_lock <std::mutex> ctxStopReading( this->lockRequestQueue );
+
+            this->condReadAhead.notify_all();
+        }
+
+        for ( std::thread& ioWorker : this->ioWorkers )
+        {
+            ioWorker.join();
+        }
+
+        this->ioWorkers.clear();
+    }
+
     // Clear all channels.
     // We just want to do things on the main thread.
     {
+        for ( Channel *channel : this->channels )
+        {
+            channel->isTerminating = true;
+        }
+
+        {
+            std::unique_lock <std::mutex> ctxWakeChannels( this->lockChannelIdle );
+
+            this->condWorkAvailable.notify_all();
+        }
+
+        // Channels look at the activities of each other, so all of them must have quit before we delete any.
+        for ( Channel *channel : this->channels )
+        {
+            channel->WaitForTermination();
+        }
+
         for ( Channel *channel : this->channels )
         {
             delete channel;
@@ -572,10 +1191,52 @@ StreamMan::~StreamMan( void )
         this->channels.clear();
     }
 
+    // Nobody is going to process the remaining requests anymore.
+    {
+        std::unique_lock <std::mutex> ctxClearQueue( this->lockRequestQueue );
+
+        Channel::request_t leftRequest;
+
+        while ( this->requestQueue.Pop( leftRequest ) );
+
+        for ( readAheadLoad_t *readLoad : this->readStage )
+        {
+            readLoad->res->isInReadStage = false;
+
+            delete readLoad;
+        }
+
+        this->readStage.clear();
+
+        for ( readAheadLoad_t *readLoad : this->freeReadLoads )
+        {
+            delete readLoad;
+        }
+
+        this->freeReadLoads.clear();
+
+        for ( Resource *parkedRes : this->parkedLoads )
+        {
+            parkedRes->isParked = false;
+            parkedRes->parkedOn.clear();
+            parkedRes->parkedData.Release();
+        }
+
+        this->parkedLoads.clear();
+    }
+
+    // Nobody is going to load anything anymore.
+    std::vector <std::pair <ticket_t, bool>> leftTickets;
+
     // Unload all resources.
-    for ( std::pair <const ident_t, Resource>& loadedRes : this->resources )
+    this->resourceTable.ForAllResources(
+        [&] ( Resource *resToUnload )
     {
-        Resource *resToUnload = &loadedRes.second;
+        {
+            std::unique_lock <std::mutex> ctxTakeTickets( this->lockTickets );
+
+            NativeTakeTickets( resToUnload, false, leftTickets );
+        }
 
         if ( resToUnload->status == eResourceStatus::LOADED )
         {
@@ -596,221 +1257,2049 @@ StreamMan::~StreamMan( void )
         }
         else
         {
-            assert( resToUnload->status == eResourceStatus::UNLOADED );
+            assert( resToUnload->status == eResourceStatus::UNLOADED );
+        }
+
+        // Terminate some things about this resource.
+        resToUnload->refCount = 0;
+    });
+
+    NativeCompleteTickets( leftTickets );
+
+    // The types are still around, so their objects can go now.
+    this->destructionQueue.SetBackgroundThread( false );
+    this->destructionQueue.RunAll();
+
+    // Anything else?
+
+    assert( this->totalStreamingMemoryUsage == 0 );
+}
+
+StreamMan::ResourceTable::ResourceTable( void ) : numUsedPages( 0 )
+{
+    for ( std::atomic <slotPage_t*>& page : this->pages )
+    {
+        page = NULL;
+    }
+}
+
+StreamMan::ResourceTable::~ResourceTable( void )
+{
+    // Resources that are still linked belong to us.
+    ForAllResources(
+        [] ( Resource *res )
+    {
+        delete res;
+    });
+
+    for ( std::atomic <slotPage_t*>& page : this->pages )
+    {
+        delete page.load();
+    }
+}
+
+StreamMan::resourceSlot_t* StreamMan::ResourceTable::AllocateSlot( ident_t id )
+{
+    if ( id < 0 || id >= ( PAGE_SIZE * MAX_PAGES ) )
+        return NULL;
+
+    size_t pageIdx = ( id / PAGE_SIZE );
+
+    slotPage_t *page = this->pages[ pageIdx ].load( std::memory_order_acquire );
+
+    if ( page == NULL )
+    {
+        // Types and resources are added under different locks, so we could race for the page.
+        slotPage_t *newPage = new slotPage_t();
+
+        if ( this->pages[ pageIdx ].compare_exchange_strong( page, newPage, std::memory_order_acq_rel ) )
+        {
+            page = newPage;
+        }
+        else
+        {
+            delete newPage;
+        }
+
+        size_t numPages = this->numUsedPages.load( std::memory_order_relaxed );
+
+        while ( numPages <= pageIdx && !this->numUsedPages.compare_exchange_weak( numPages, pageIdx + 1, std::memory_order_release ) );
+    }
+
+    return &page->slots[ id % PAGE_SIZE ];
+}
+
+StreamMan::RequestQueue::RequestQueue( void )
+{
+    this->curSequence = 0;
+}
+
+// only THREAD-SAFE if called from EXCLUSIVE-LOCK at lockRequestQueue !
+void StreamMan::RequestQueue::SetEntry( size_t idx, entry_t entry )
+{
+    if ( Resource *loadRes = entry.loadRes )
+    {
+        loadRes->queueIndex = idx;
+    }
+
+    this->heap[ idx ] = std::move( entry );
+}
+
+void StreamMan::RequestQueue::SiftUp( size_t idx )
+{
+    entry_t entry = std::move( this->heap[ idx ] );
+
+    while ( idx > 0 )
+    {
+        size_t parentIdx = ( idx - 1 ) / 2;
+
+        if ( IsMoreUrgent( entry, this->heap[ parentIdx ] ) == false )
+            break;
+
+        SetEntry( idx, std::move( this->heap[ parentIdx ] ) );
+
+        idx = parentIdx;
+    }
+
+    SetEntry( idx, std::move( entry ) );
+}
+
+void StreamMan::RequestQueue::SiftDown( size_t idx )
+{
+    size_t count = this->heap.size();
+
+    entry_t entry = std::move( this->heap[ idx ] );
+
+    while ( true )
+    {
+        size_t childIdx = ( idx * 2 + 1 );
+
+        if ( childIdx >= count )
+            break;
+
+        // Take the more urgent child.
+        if ( childIdx + 1 < count && IsMoreUrgent( this->heap[ childIdx + 1 ], this->heap[ childIdx ] ) )
+        {
+            childIdx++;
+        }
+
+        if ( IsMoreUrgent( this->heap[ childIdx ], entry ) == false )
+            break;
+
+        SetEntry( idx, std::move( this->heap[ childIdx ] ) );
+
+        idx = childIdx;
+    }
+
+    SetEntry( idx, std::move( entry ) );
+}
+
+void StreamMan::RequestQueue::RemoveAt( size_t idx )
+{
+    if ( Resource *loadRes = this->heap[ idx ].loadRes )
+    {
+        loadRes->queueIndex = Resource::NOT_QUEUED;
+
+        // Whoever takes the load carries it out, unless it is cancelled from now on.
+        loadRes->MarkLoadWanted();
+
+        loadRes->queueWaitTime.store( GetStreamingTime() - loadRes->queueTime, std::memory_order_relaxed );
+    }
+
+    size_t lastIdx = ( this->heap.size() - 1 );
+
+    if ( idx != lastIdx )
+    {
+        // Fill the hole with the last entry and restore the heap property.
+        SetEntry( idx, std::move( this->heap[ lastIdx ] ) );
+
+        this->heap.pop_back();
+
+        SiftDown( idx );
+        SiftUp( idx );
+    }
+    else
+    {
+        this->heap.pop_back();
+    }
+}
+
+bool StreamMan::RequestQueue::Push( Channel::request_t request, Resource *res, float priority )
+{
+    Resource *loadRes = NULL;
+
+    if ( request.reqType == Channel::eRequestType::LOAD )
+    {
+        // Loads in the I/O stage or parked loads are as good as queued.
+        if ( res && ( res->isInReadStage || res->isParked ) )
+        {
+            res->loadPriority = priority;
+
+            return false;
+        }
+
+        // If this resource is already queued for loading, we just update its priority.
+        if ( res && res->queueIndex != Resource::NOT_QUEUED )
+        {
+            size_t idx = res->queueIndex;
+
+            entry_t& entry = this->heap[ idx ];
+
+            float oldPriority = entry.priority;
+
+            entry.priority = priority;
+
+            res->loadPriority = priority;
+
+            if ( priority < oldPriority )
+            {
+                SiftUp( idx );
+            }
+            else if ( priority > oldPriority )
+            {
+                SiftDown( idx );
+            }
+
+            return false;
+        }
+
+        loadRes = res;
+
+        if ( loadRes )
+        {
+            loadRes->loadPriority = priority;
+            loadRes->queueTime = GetStreamingTime();
+        }
+    }
+    else if ( request.reqType == Channel::eRequestType::UNLOAD )
+    {
+        // Unloading a resource supersedes loading it.
+        if ( res )
+        {
+            RemoveLoad( res );
+        }
+    }
+
+    entry_t newEntry;
+    newEntry.request = std::move( request );
+    newEntry.loadRes = loadRes;
+    newEntry.priority = priority;
+    newEntry.sequence = this->curSequence++;
+
+    this->heap.push_back( entry_t() );
+
+    SetEntry( this->heap.size() - 1, std::move( newEntry ) );
+
+    SiftUp( this->heap.size() - 1 );
+
+    return true;
+}
+
+bool StreamMan::RequestQueue::RemoveLoad( Resource *res )
+{
+    if ( res->queueIndex == Resource::NOT_QUEUED )
+        return false;
+
+    RemoveAt( res->queueIndex );
+
+    return true;
+}
+
+bool StreamMan::RequestQueue::Pop( Channel::request_t& requestOut, Resource **loadResOut )
+{
+    if ( this->heap.empty() )
+        return false;
+
+    requestOut = this->heap.front().request;
+
+    if ( loadResOut )
+    {
+        *loadResOut = this->heap.front().loadRes;
+    }
+
+    RemoveAt( 0 );
+
+    return true;
+}
+
+void StreamMan::RequestQueue::TakeBulkNeighbours( const Resource *res, std::vector <Channel::batchedLoad_t>& batchOut )
+{
+    const void *bulkSource = res->bulkSource;
+
+    unsigned long long spanStart = res->bulkOffset;
+    unsigned long long spanEnd = ( spanStart + res->resourceSize );
+
+    // Find all queued loads that could fit into the span.
+    std::vector <Resource*>& candidates = this->bulkCandidates;
+
+    unsigned long long searchStart = ( spanStart - std::min( spanStart, (unsigned long long)STREAMING_BULK_MAX_SPAN ) );
+    unsigned long long searchEnd = ( spanEnd + STREAMING_BULK_MAX_SPAN );
+
+    for ( const entry_t& entry : this->heap )
+    {
+        Resource *loadRes = entry.loadRes;
+
+        if ( loadRes && loadRes->bulkSource == bulkSource &&
+             loadRes->bulkOffset >= searchStart && loadRes->bulkOffset < searchEnd )
+        {
+            candidates.push_back( loadRes );
+        }
+    }
+
+    // Closest first.
+    std::sort( candidates.begin(), candidates.end(),
+        [&] ( const Resource *left, const Resource *right )
+    {
+        unsigned long long leftDist = ( left->bulkOffset > spanStart ? left->bulkOffset - spanStart : spanStart - left->bulkOffset );
+        unsigned long long rightDist = ( right->bulkOffset > spanStart ? right->bulkOffset - spanStart : spanStart - right->bulkOffset );
+
+        return ( leftDist < rightDist );
+    });
+
+    size_t numTaken = 0;
+
+    for ( Resource *candidate : candidates )
+    {
+        if ( numTaken == ( STREAMING_BULK_MAX_REQUESTS - 1 ) )
+            break;
+
+        unsigned long long newStart = std::min( spanStart, candidate->bulkOffset );
+        unsigned long long newEnd = std::max( spanEnd, candidate->bulkOffset + candidate->resourceSize );
+
+        if ( ( newEnd - newStart ) > STREAMING_BULK_MAX_SPAN )
+            continue;
+
+        spanStart = newStart;
+        spanEnd = newEnd;
+
+        Channel::batchedLoad_t batched;
+        batched.request = this->heap[ candidate->queueIndex ].request;
+        batched.res = candidate;
+        batched.activity = NULL;
+        batched.prefetchedData = NULL;
+
+        batchOut.push_back( std::move( batched ) );
+
+        RemoveLoad( candidate );
+
+        numTaken++;
+    }
+
+    candidates.clear();
+}
+
+bool StreamMan::RequestQueue::IsQueued( ident_t id ) const
+{
+    for ( const entry_t& entry : this->heap )
+    {
+        if ( entry.request.resID == id )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void StreamMan::NativePushStreamingRequest( Channel::request_t request, Resource *res, float priority )
+{
+    size_t numNewRequests = 0;
+    {
+        std::unique_lock <std::mutex> ctxPushRequest( this->lockRequestQueue );
+
+        bool isLoad = ( request.reqType == Channel::eRequestType::LOAD );
+
+        numNewRequests = NativeQueueRequestNoLock( std::move( request ), res, priority );
+
+        // Let the I/O stage read it ahead.
+        if ( isLoad && this->ioWorkers.empty() == false )
+        {
+            this->condReadAhead.notify_one();
+        }
+    }
+
+    if ( numNewRequests != 0 )
+    {
+        this->numOutstandingRequests += numNewRequests;
+        this->numQueuedRequests += numNewRequests;
+
+        // Notify the channels that a new request is available!
+        NativeWakeChannels();
+    }
+}
+
+size_t StreamMan::NativeQueueRequestNoLock( Channel::request_t request, Resource *res, float priority )
+{
+    // Requests can be merged or superseded, so count what really changed.
+    size_t oldCount = this->requestQueue.GetCount();
+
+    // Unloading a resource supersedes its parked load too.
+    if ( request.reqType != Channel::eRequestType::LOAD && res )
+    {
+        NativeDropParkedLoad( res );
+    }
+
+    this->requestQueue.Push( std::move( request ), res, priority );
+
+    return ( this->requestQueue.GetCount() - oldCount );
+}
+
+void StreamMan::NativeQueueRequests( size_t numNewRequests, size_t numNewLoads )
+{
+    // Called after a whole batch has been queued, outside of lockRequestQueue.
+    if ( numNewLoads != 0 && this->ioWorkers.empty() == false )
+    {
+        this->condReadAhead.notify_all();
+    }
+
+    if ( numNewRequests != 0 )
+    {
+        this->numOutstandingRequests += numNewRequests;
+        this->numQueuedRequests += numNewRequests;
+
+        NativeWakeChannels( numNewRequests );
+    }
+}
+
+bool StreamMan::NativeFetchRequest( Channel *channel, Channel::request_t& requestOut, Channel::Activity*& activityOut )
+{
+    // All requests go through the shared queue, most urgent first.
+    // Whichever channel is free takes the next one, so the work is balanced without any stealing.
+    std::unique_lock <std::mutex> ctxPopRequest( this->lockRequestQueue );
+
+    // Loads that have been read by the I/O stage only need to be given to the runtime.
+    readAheadLoad_t *readLoad = NULL;
+
+    for ( auto iter = this->readStage.begin(); iter != this->readStage.end(); iter++ )
+    {
+        if ( (*iter)->isRead )
+        {
+            readLoad = *iter;
+
+            this->readStage.erase( iter );
+            break;
+        }
+    }
+
+    if ( readLoad )
+    {
+        readLoad->res->isInReadStage = false;
+
+        // It is still pending until the channel has acquired the resource.
+        readLoad->res->numTakenLoads++;
+
+        requestOut = readLoad->request;
+
+        channel->readAheadLoad = readLoad;
+
+        // Waiting people must not miss it.
+        {
+            exclusive_lock_acquire <std::shared_timed_mutex> ctxActivityUpdate( channel->channelLock );
+
+            activityOut = channel->AllocateActivity( requestOut );
+        }
+
+        this->numQueuedRequests--;
+
+        ctxPopRequest.unlock();
+
+        this->condQueueUpdate.notify_all();
+
+        return true;
+    }
+
+    Resource *loadRes = NULL;
+
+    if ( this->requestQueue.Pop( requestOut, &loadRes ) )
+    {
+        std::vector <Channel::batchedLoad_t>& batch = channel->batchedLoads;
+
+        // Take loads of resources next to this one along, so that we can read them together.
+        if ( loadRes && loadRes->bulkSource )
+        {
+            Channel::batchedLoad_t mainLoad;
+            mainLoad.request = requestOut;
+            mainLoad.res = loadRes;
+            mainLoad.activity = NULL;
+            mainLoad.prefetchedData = NULL;
+
+            batch.push_back( std::move( mainLoad ) );
+
+            this->requestQueue.TakeBulkNeighbours( loadRes, batch );
+
+            // Nothing to read together with?
+            if ( batch.size() == 1 )
+            {
+                batch.clear();
+            }
+        }
+
+        // The loads are still pending until the channel has acquired their resources.
+        if ( loadRes )
+        {
+            loadRes->numTakenLoads++;
+        }
+
+        for ( size_t n = 1; n < batch.size(); n++ )
+        {
+            batch[ n ].res->numTakenLoads++;
+        }
+
+        // Register the activities while the requests are leaving the queue.
+        // That way people waiting for these resources cannot miss them.
+        {
+            exclusive_lock_acquire <std::shared_timed_mutex> ctxActivityUpdate( channel->channelLock );
+
+            activityOut = channel->AllocateActivity( requestOut );
+
+            for ( size_t n = 0; n < batch.size(); n++ )
+            {
+                batch[ n ].activity = ( n == 0 ? activityOut : channel->AllocateActivity( batch[ n ].request ) );
+            }
+        }
+
+        this->numQueuedRequests -= std::max( batch.size(), (size_t)1 );
+
+        ctxPopRequest.unlock();
+
+        this->condQueueUpdate.notify_all();
+
+        // There could be a load on top of the queue now.
+        if ( this->ioWorkers.empty() == false )
+        {
+            this->condReadAhead.notify_one();
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+void StreamMan::NativeReadBatchedLoads( std::vector <Channel::batchedLoad_t>& batch, StreamingBuffer& batchBuffer )
+{
+    // Read in the order that the data is stored in.
+    std::sort( batch.begin(), batch.end(),
+        [] ( const Channel::batchedLoad_t& left, const Channel::batchedLoad_t& right )
+    {
+        return ( left.res->bulkOffset < right.res->bulkOffset );
+    });
+
+    // Loads that are close enough to each other are merged into one read.
+    struct bulkRun_t
+    {
+        size_t firstLoad, endLoad;
+        unsigned long long start, end;
+    };
+
+    std::vector <bulkRun_t> runs;
+
+    // Cached loads do not have to be read, they fetch their data on their own.
+    std::vector <bool> isCached( batch.size(), false );
+
+    size_t bufferSize = 0;
+
+    for ( size_t n = 0; n < batch.size(); n++ )
+    {
+        const Resource *res = batch[ n ].res;
+
+        if ( this->rawCache.Contains( res->id ) )
+        {
+            isCached[ n ] = true;
+            continue;
+        }
+
+        unsigned long long resStart = res->bulkOffset;
+        unsigned long long resEnd = ( resStart + res->resourceSize );
+
+        if ( runs.empty() == false && resStart <= ( runs.back().end + STREAMING_BULK_MAX_GAP ) )
+        {
+            bulkRun_t& curRun = runs.back();
+
+            if ( resEnd > curRun.end )
+            {
+                bufferSize += (size_t)( resEnd - curRun.end );
+
+                curRun.end = resEnd;
+            }
+
+            curRun.endLoad = ( n + 1 );
+        }
+        else
+        {
+            bulkRun_t newRun;
+            newRun.firstLoad = n;
+            newRun.endLoad = ( n + 1 );
+            newRun.start = resStart;
+            newRun.end = resEnd;
+
+            runs.push_back( newRun );
+
+            bufferSize += res->resourceSize;
+        }
+    }
+
+    batchBuffer = this->bufferPool.Allocate( bufferSize );
+
+    char *bufferPtr = (char*)batchBuffer.GetData();
+
+    for ( const bulkRun_t& run : runs )
+    {
+        size_t runSize = (size_t)( run.end - run.start );
+
+        try
+        {
+            unsigned long long ioStartTime = GetStreamingTime();
+
+            batch[ run.firstLoad ].res->location->fetchBulkData( run.start, bufferPtr, runSize );
+
+            // Every load of the run had to wait for the whole read.
+            unsigned long long ioTime = ( GetStreamingTime() - ioStartTime );
+
+            for ( size_t n = run.firstLoad; n < run.endLoad; n++ )
+            {
+                if ( isCached[ n ] )
+                    continue;
+
+                batch[ n ].prefetchedData = ( bufferPtr + (size_t)( batch[ n ].res->bulkOffset - run.start ) );
+
+                batch[ n ].res->ioTime.store( ioTime, std::memory_order_relaxed );
+            }
+        }
+        catch( ... )
+        {
+            // The loads of this run will fetch their data on their own.
+        }
+
+        bufferPtr += runSize;
+    }
+}
+
+// Reads the data of a resource, from the raw cache if it is there.
+void StreamMan::NativeFetchResourceData( Resource *res, void *dataBuf )
+{
+    unsigned long long ioStartTime = GetStreamingTime();
+
+    if ( this->rawCache.Fetch( res->id, dataBuf, res->resourceSize ) == false )
+    {
+        res->location->fetchData( dataBuf );
+    }
+
+    res->ioTime.store( GetStreamingTime() - ioStartTime, std::memory_order_relaxed );
+}
+
+void StreamMan::NativeIOWorkerRuntime( void )
+{
+    // Kept around so that reading does not allocate all the time.
+    std::vector <Channel::batchedLoad_t> batch;
+    StreamingBuffer batchBuffer;
+    std::vector <readAheadLoad_t*> readLoads;
+
+    // All reads of the loads that were taken are in flight at once.
+    std::mutex lockPendingReads;
+    std::condition_variable condReadFinished;
+    size_t numPendingReads = 0;     // must be ACCESSED UNDER lockPendingReads !
+
+    while ( true )
+    {
+        // Take the most urgent load (and its neighbours, or other loads to read at the same time) off the queue.
+        {
+            std::unique_lock <std::mutex> ctxTakeLoads( this->lockRequestQueue );
+
+            this->condReadAhead.wait( ctxTakeLoads,
+                [&]
+            {
+                return ( this->isTerminating || NativeCanReadAhead() );
+            });
+
+            if ( this->isTerminating )
+                break;
+
+            Channel::batchedLoad_t mainLoad;
+            mainLoad.activity = NULL;
+            mainLoad.prefetchedData = NULL;
+
+            this->requestQueue.Pop( mainLoad.request, &mainLoad.res );
+
+            batch.push_back( std::move( mainLoad ) );
+
+            if ( batch.front().res->bulkSource )
+            {
+                this->requestQueue.TakeBulkNeighbours( batch.front().res, batch );
+            }
+
+            auto stageLoad = [&] ( const Channel::batchedLoad_t& load )
+            {
+                readAheadLoad_t *readLoad = NULL;
+
+                if ( this->freeReadLoads.empty() )
+                {
+                    readLoad = new readAheadLoad_t;
+                }
+                else
+                {
+                    readLoad = this->freeReadLoads.back();
+
+                    this->freeReadLoads.pop_back();
+                }
+
+                readLoad->request = load.request;
+                readLoad->res = load.res;
+                readLoad->dataSize = load.res->resourceSize;
+                readLoad->isRead = false;
+                readLoad->hasData = false;
+
+                // The resource cannot be deleted while it is in the stage, so we can read from it without locks.
+                load.res->isInReadStage = true;
+
+                this->readStage.push_back( readLoad );
+
+                this->readStageMemory += readLoad->dataSize;
+
+                readLoads.push_back( readLoad );
+            };
+
+            for ( const Channel::batchedLoad_t& load : batch )
+            {
+                stageLoad( load );
+            }
+
+            // Loads that cannot be read together are read at the same time instead, as long as the stage has room.
+            if ( batch.front().res->bulkSource == NULL )
+            {
+                while ( readLoads.size() < STREAMING_READ_AHEAD_MAX_IN_FLIGHT && NativeCanReadAhead() )
+                {
+                    // It is read together with its neighbours next time.
+                    if ( this->requestQueue.GetTopLoad()->bulkSource )
+                        break;
+
+                    Channel::batchedLoad_t nextLoad;
+                    nextLoad.activity = NULL;
+                    nextLoad.prefetchedData = NULL;
+
+                    this->requestQueue.Pop( nextLoad.request, &nextLoad.res );
+
+                    stageLoad( nextLoad );
+
+                    batch.push_back( std::move( nextLoad ) );
+                }
+            }
+
+            // Channels cannot take these loads before we are done reading them.
+            this->numQueuedRequests -= batch.size();
+        }
+
+        if ( batch.size() > 1 && batch.front().res->bulkSource )
+        {
+            // Resources that are stored next to each other are read in one go.
+            NativeReadBatchedLoads( batch, batchBuffer );
+        }
+
+        for ( readAheadLoad_t *readLoad : readLoads )
+        {
+            const void *prefetchedData = NULL;
+
+            for ( const Channel::batchedLoad_t& load : batch )
+            {
+                if ( load.res == readLoad->res )
+                {
+                    prefetchedData = load.prefetchedData;
+                    break;
+                }
+            }
+
+            // Cancelled loads are not worth reading, the channel is going to drop them.
+            if ( readLoad->res->IsLoadCancelled() )
+            {
+                NativeFinishReadAhead( readLoad );
+                continue;
+            }
+
+            // Mapped data is used in place by the channel, reading it ahead would just copy it.
+            if ( prefetchedData == NULL )
+            {
+                dataView_t dataView( readLoad->res->location );
+
+                if ( dataView.Acquire() != NULL )
+                {
+                    NativeFinishReadAhead( readLoad );
+                    continue;
+                }
+            }
+
+            bool isReading = false;
+
+            try
+            {
+                readLoad->buffer = this->bufferPool.Allocate( readLoad->dataSize );
+
+                if ( prefetchedData )
+                {
+                    memcpy( readLoad->buffer.GetData(), prefetchedData, readLoad->dataSize );
+
+                    readLoad->hasData = true;
+                }
+                else if ( this->rawCache.Fetch( readLoad->res->id, readLoad->buffer.GetData(), readLoad->dataSize ) )
+                {
+                    readLoad->hasData = true;
+                }
+                else
+                {
+                    // The load goes to the channels as soon as its read is done, the others stay in flight meanwhile.
+                    unsigned long long ioStartTime = GetStreamingTime();
+
+                    {
+                        std::unique_lock <std::mutex> ctxStartRead( lockPendingReads );
+
+                        numPendingReads++;
+                    }
+
+                    isReading = true;
+
+                    readLoad->res->location->fetchDataAsync( readLoad->buffer.GetData(),
+                        [this, readLoad, ioStartTime, &lockPendingReads, &condReadFinished, &numPendingReads] ( bool isFetched )
+                    {
+                        readLoad->res->ioTime.store( GetStreamingTime() - ioStartTime, std::memory_order_relaxed );
+
+                        // If this failed, the channel is going to try on its own.
+                        readLoad->hasData = isFetched;
+
+                        NativeFinishReadAhead( readLoad );
+
+                        std::unique_lock <std::mutex> ctxFinishRead( lockPendingReads );
+
+                        numPendingReads--;
+
+                        condReadFinished.notify_all();
+                    });
+                }
+            }
+            catch( ... )
+            {
+                // The channel is going to try on its own.
+            }
+
+            if ( isReading == false )
+            {
+                NativeFinishReadAhead( readLoad );
+            }
+        }
+
+        batch.clear();
+        batchBuffer.Release();
+        readLoads.clear();
+    }
+
+    // Reads that are still in flight refer to us.
+    {
+        std::unique_lock <std::mutex> ctxWaitForReads( lockPendingReads );
+
+        condReadFinished.wait( ctxWaitForReads,
+            [&]
+        {
+            return ( numPendingReads == 0 );
+        });
+    }
+}
+
+// Hands a load that the I/O stage is done with to the channels.
+void StreamMan::NativeFinishReadAhead( readAheadLoad_t *readLoad )
+{
+    {
+        std::unique_lock <std::mutex> ctxFinishReading( this->lockRequestQueue );
+
+        readLoad->isRead = true;
+
+        this->numQueuedRequests++;
+    }
+
+    NativeWakeChannels();
+
+    // Unlinking could be waiting for us to finish reading.
+    this->condQueueUpdate.notify_all();
+}
+
+// only THREAD-SAFE if called from EXCLUSIVE-LOCK at lockRequestQueue !
+bool StreamMan::NativeCanReadAhead( void ) const
+{
+    // Only loads are read ahead, the channels take care of anything else.
+    if ( this->requestQueue.IsLoadOnTop() == false )
+        return false;
+
+    if ( this->readStage.size() >= STREAMING_READ_AHEAD_MAX_LOADS )
+        return false;
+
+    // Loads that are bigger than the whole budget are still read if nothing else is.
+    return ( this->readStageMemory < STREAMING_READ_AHEAD_MAX_MEMORY );
+}
+
+// only THREAD-SAFE if called from EXCLUSIVE-LOCK at lockRequestQueue !
+bool StreamMan::NativeIsInReadStage( ident_t id ) const
+{
+    for ( const readAheadLoad_t *readLoad : this->readStage )
+    {
+        if ( readLoad->request.resID == id )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// only THREAD-SAFE if called from EXCLUSIVE-LOCK at lockRequestQueue !
+void StreamMan::NativeRemoveFromReadStage( Resource *res, std::unique_lock <std::mutex>& ctxQueueLock )
+{
+    while ( res->isInReadStage )
+    {
+        auto iter = std::find_if( this->readStage.begin(), this->readStage.end(),
+            [&] ( const readAheadLoad_t *readLoad )
+        {
+            return ( readLoad->res == res );
+        });
+
+        assert( iter != this->readStage.end() );
+
+        readAheadLoad_t *readLoad = *iter;
+
+        if ( readLoad->isRead == false )
+        {
+            // An I/O worker is still reading from this resource.
+            this->condQueueUpdate.wait( ctxQueueLock );
+            continue;
+        }
+
+        this->readStage.erase( iter );
+
+        res->isInReadStage = false;
+
+        NativeRecycleReadLoad( readLoad );
+
+        this->numQueuedRequests--;
+
+        NativeFinishRequest();
+
+        this->condReadAhead.notify_all();
+    }
+}
+
+// only THREAD-SAFE if called from EXCLUSIVE-LOCK at lockRequestQueue !
+void StreamMan::NativeRecycleReadLoad( readAheadLoad_t *readLoad )
+{
+    this->readStageMemory -= readLoad->dataSize;
+
+    // The channel could have handed the buffer to the streaming type.
+    readLoad->buffer.Release();
+
+    this->freeReadLoads.push_back( readLoad );
+}
+
+void StreamMan::NativeReleaseReadAhead( Channel *channel )
+{
+    readAheadLoad_t *readLoad = channel->readAheadLoad;
+
+    channel->readAheadLoad = NULL;
+
+    {
+        std::unique_lock <std::mutex> ctxReleaseLoad( this->lockRequestQueue );
+
+        NativeRecycleReadLoad( readLoad );
+    }
+
+    // There is room in the I/O stage again.
+    this->condReadAhead.notify_all();
+}
+
+bool StreamMan::NativeParkLoad( const Channel::request_t& request, StreamingBuffer *prefetchedBuffer )
+{
+    shared_lock_acquire <std::shared_timed_mutex> ctxDependsAvailability( this->lockResourceAvail );
+
+    shared_lock_acquire <std::shared_timed_mutex> ctxTraverseDependencies( this->lockDependsMutate );
+
+    Resource *res = GetResourceAtID( request.resID );
+
+    if ( res == NULL || res->depends.empty() )
+        return false;
+
+    // Announce that we are parking before looking at the dependencies.
+    // Dependencies that finish in the meantime then cannot miss us.
+    this->numParkedLoads++;
+
+    size_t numNewRequests = 0;
+    {
+        std::unique_lock <std::mutex> ctxParkLoad( this->lockRequestQueue );
+
+        // Somebody else could be taking care of this resource already.
+        bool canPark =
+            ( this->isTerminating == false && res->isAllowedToLoad &&
+              res->status == eResourceStatus::UNLOADED &&
+              res->queueIndex == Resource::NOT_QUEUED && res->isInReadStage == false && res->isParked == false );
+
+        if ( canPark )
+        {
+            for ( Resource *dependency : res->depends )
+            {
+                eResourceStatus status = dependency->status;
+
+                if ( status == eResourceStatus::LOADED )
+                    continue;
+
+                // Let the other channels load it, at least as urgently as us.
+                // If it is being processed already then we just wait for it to finish.
+                bool isLoadPending = ( dependency->queueIndex != Resource::NOT_QUEUED || dependency->isInReadStage || dependency->isParked );
+
+                if ( status == eResourceStatus::UNLOADED &&
+                     ( isLoadPending == false || dependency->loadPriority > res->loadPriority ) )
+                {
+                    Channel::request_t depRequest;
+                    depRequest.reqType = Channel::eRequestType::LOAD;
+                    depRequest.resID = dependency->id;
+
+                    if ( this->requestQueue.Push( depRequest, dependency, res->loadPriority ) )
+                    {
+                        numNewRequests++;
+                    }
+                }
+
+                NativeParkOn( res, dependency );
+            }
+        }
+
+        if ( res->parkedOn.empty() )
+        {
+            // All dependencies are loaded, so just go ahead.
+            this->numParkedLoads--;
+
+            return false;
+        }
+
+        NativeFinishParking( res, prefetchedBuffer );
+
+        this->numOutstandingRequests += numNewRequests;
+        this->numQueuedRequests += numNewRequests;
+
+        if ( numNewRequests != 0 && this->ioWorkers.empty() == false )
+        {
+            this->condReadAhead.notify_all();
+        }
+    }
+
+    for ( size_t n = 0; n < numNewRequests; n++ )
+    {
+        NativeWakeChannels();
+    }
+
+    return true;
+}
+
+// Returns false if the load has not been parked, then whoever took over from us carries it out (if anybody).
+bool StreamMan::NativeSuspendLoad( const Channel::request_t& request, ident_t waitForID, StreamingBuffer *prefetchedBuffer )
+{
+    shared_lock_acquire <std::shared_timed_mutex> ctxResourceAvailability( this->lockResourceAvail );
+
+    Resource *res = GetResourceAtID( request.resID );
+
+    if ( res == NULL )
+        return false;
+
+    Resource *waitFor = GetResourceAtID( waitForID );
+
+    // Same as parking, the resource we wait for must not finish unnoticed.
+    this->numParkedLoads++;
+
+    std::unique_lock <std::mutex> ctxSuspendLoad( this->lockRequestQueue );
+
+    // If the load has been queued again in the meantime then that request takes over.
+    // The resource can still be unloading if we wait for the channel that unloads it.
+    eResourceStatus status = res->status;
+
+    bool canPark =
+        ( this->isTerminating == false && res->isAllowedToLoad &&
+          ( status == eResourceStatus::UNLOADED || status == eResourceStatus::UNLOADING ) &&
+          res->queueIndex == Resource::NOT_QUEUED && res->isInReadStage == false && res->isParked == false );
+
+    if ( canPark == false )
+    {
+        this->numParkedLoads--;
+
+        return false;
+    }
+
+    // Owners only let go of resources before they resume the loads that are parked on them.
+    if ( waitFor && waitFor->syncOwner != NULL )
+    {
+        NativeParkOn( res, waitFor );
+    }
+
+    NativeFinishParking( res, prefetchedBuffer );
+
+    // The other channel could have finished already, then we just try again.
+    if ( res->parkedOn.empty() )
+    {
+        NativeResumeParkedLoad( res );
+    }
+
+    return true;
+}
+
+// only THREAD-SAFE if called from EXCLUSIVE-LOCK at lockRequestQueue !
+void StreamMan::NativeParkOn( Resource *res, Resource *waitFor )
+{
+    waitFor->parkedDependents.push_back( res );
+
+    res->parkedOn.push_back( waitFor );
+}
+
+// only THREAD-SAFE if called from EXCLUSIVE-LOCK at lockRequestQueue !
+void StreamMan::NativeFinishParking( Resource *res, StreamingBuffer *prefetchedBuffer )
+{
+    res->isParked = true;
+
+    this->parkedLoads.push_back( res );
+
+    // Do not read the data twice.
+    if ( prefetchedBuffer && prefetchedBuffer->IsValid() )
+    {
+        res->parkedData = std::move( *prefetchedBuffer );
+    }
+
+    // The parked load counts as outstanding until it has been processed after all.
+    this->numOutstandingRequests++;
+}
+
+// Queues the LOAD request of a resource again, as urgent as it was queued before.
+void StreamMan::NativeRequeueLoad( Resource *res )
+{
+    bool isNewRequest = false;
+    {
+        std::unique_lock <std::mutex> ctxRequeueLoad( this->lockRequestQueue );
+
+        Channel::request_t request;
+        request.reqType = Channel::eRequestType::LOAD;
+        request.resID = res->id;
+
+        isNewRequest = this->requestQueue.Push( request, res, res->loadPriority );
+
+        if ( isNewRequest )
+        {
+            this->numOutstandingRequests++;
+            this->numQueuedRequests++;
+
+            if ( this->ioWorkers.empty() == false )
+            {
+                this->condReadAhead.notify_one();
+            }
+        }
+    }
+
+    if ( isNewRequest )
+    {
+        NativeWakeChannels();
+    }
+}
+
+// only THREAD-SAFE if called from EXCLUSIVE-LOCK at lockRequestQueue !
+bool StreamMan::NativeIsParked( ident_t id ) const
+{
+    for ( const Resource *parkedRes : this->parkedLoads )
+    {
+        if ( parkedRes->id == id )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Has to be called once a resource has finished processing, no matter if successfully.
+// res must stay valid during this call.
+void StreamMan::NativeResumeDependents( Resource *res )
+{
+    // Most of the time nothing is parked.
+    if ( this->numParkedLoads == 0 )
+        return;
+
+    std::unique_lock <std::mutex> ctxResumeLoads( this->lockRequestQueue );
+
+    NativeResumeDependentsNoLock( res );
+}
+
+// only THREAD-SAFE if called from EXCLUSIVE-LOCK at lockRequestQueue !
+void StreamMan::NativeResumeDependentsNoLock( Resource *res )
+{
+    if ( res->parkedDependents.empty() )
+        return;
+
+    std::vector <Resource*> dependents = std::move( res->parkedDependents );
+
+    res->parkedDependents.clear();
+
+    for ( Resource *parkedRes : dependents )
+    {
+        auto iter = std::find( parkedRes->parkedOn.begin(), parkedRes->parkedOn.end(), res );
+
+        assert( iter != parkedRes->parkedOn.end() );
+
+        parkedRes->parkedOn.erase( iter );
+
+        // Whatever the outcome of its dependencies, the load can continue.
+        // If one of them failed then it is loaded by the resumed load itself.
+        if ( parkedRes->parkedOn.empty() )
+        {
+            NativeResumeParkedLoad( parkedRes );
+        }
+    }
+}
+
+// only THREAD-SAFE if called from EXCLUSIVE-LOCK at lockRequestQueue !
+void StreamMan::NativeResumeParkedLoad( Resource *res )
+{
+    NativeRemoveParkedLoad( res );
+
+    Channel::request_t request;
+    request.reqType = Channel::eRequestType::LOAD;
+    request.resID = res->id;
+    request.isResumed = true;
+
+    if ( res->parkedData.IsValid() )
+    {
+        // The data has been read already, so the channels can take it right away.
+        readAheadLoad_t *readLoad = NULL;
+
+        if ( this->freeReadLoads.empty() )
+        {
+            readLoad = new readAheadLoad_t;
+        }
+        else
+        {
+            readLoad = this->freeReadLoads.back();
+
+            this->freeReadLoads.pop_back();
+        }
+
+        readLoad->request = request;
+        readLoad->res = res;
+        readLoad->dataSize = res->resourceSize;
+        readLoad->buffer = std::move( res->parkedData );
+        readLoad->isRead = true;
+        readLoad->hasData = true;
+
+        res->isInReadStage = true;
+
+        this->readStage.push_back( readLoad );
+
+        this->readStageMemory += readLoad->dataSize;
+    }
+    else
+    {
+        bool isNewRequest = this->requestQueue.Push( request, res, res->loadPriority );
+
+        // Parked loads cannot be queued at the same time.
+        assert( isNewRequest == true );
+
+        if ( this->ioWorkers.empty() == false )
+        {
+            this->condReadAhead.notify_one();
+        }
+    }
+
+    // It has been outstanding since it was parked.
+    this->numQueuedRequests++;
+
+    NativeWakeChannels();
+}
+
+// only THREAD-SAFE if called from EXCLUSIVE-LOCK at lockRequestQueue !
+void StreamMan::NativeDropParkedLoad( Resource *res )
+{
+    if ( res->isParked == false )
+        return;
+
+    for ( Resource *dependency : res->parkedOn )
+    {
+        auto iter = std::find( dependency->parkedDependents.begin(), dependency->parkedDependents.end(), res );
+
+        assert( iter != dependency->parkedDependents.end() );
+
+        dependency->parkedDependents.erase( iter );
+    }
+
+    res->parkedOn.clear();
+
+    res->parkedData.Release();
+
+    NativeRemoveParkedLoad( res );
+
+    NativeFinishRequest();
+
+    // Waiting people could be waiting for the parked load.
+    this->condQueueUpdate.notify_all();
+}
+
+// only THREAD-SAFE if called from EXCLUSIVE-LOCK at lockRequestQueue !
+void StreamMan::NativeRemoveParkedLoad( Resource *res )
+{
+    auto iter = std::find( this->parkedLoads.begin(), this->parkedLoads.end(), res );
+
+    assert( iter != this->parkedLoads.end() );
+
+    this->parkedLoads.erase( iter );
+
+    res->isParked = false;
+
+    this->numParkedLoads--;
+}
+
+bool StreamMan::NativeWaitForWork( Channel *channel )
+{
+    if ( channel->isTerminating )
+        return false;
+
+    // Quick check for busy times.
+    if ( this->numQueuedRequests != 0 )
+        return true;
+
+    std::unique_lock <std::mutex> ctxWaitForWork( this->lockChannelIdle );
+
+    this->numIdleChannels++;
+
+    this->condWorkAvailable.wait( ctxWaitForWork,
+        [&]
+    {
+        return ( channel->isTerminating || this->numQueuedRequests != 0 );
+    });
+
+    this->numIdleChannels--;
+
+    return ( channel->isTerminating == false );
+}
+
+void StreamMan::NativeWakeChannels( size_t numNewRequests )
+{
+    // Busy channels come back for work on their own.
+    if ( this->numIdleChannels == 0 )
+        return;
+
+    {
+        std::unique_lock <std::mutex> ctxWakeChannels( this->lockChannelIdle );
+    }
+
+    // A batch of requests is worth waking everybody for.
+    if ( numNewRequests > 1 )
+    {
+        this->condWorkAvailable.notify_all();
+    }
+    else
+    {
+        this->condWorkAvailable.notify_one();
+    }
+}
+
+void StreamMan::NativeFinishRequest( void )
+{
+    if ( --this->numOutstandingRequests == 0 )
+    {
+        std::unique_lock <std::mutex> ctxRequestsDone( this->lockOutstanding );
+
+        this->condAllRequestsDone.notify_all();
+    }
+}
+
+void StreamMan::NativeWaitForAllRequests( void ) const
+{
+    std::unique_lock <std::mutex> ctxWaitRequests( this->lockOutstanding );
+
+    this->condAllRequestsDone.wait( ctxWaitRequests,
+        [&]
+    {
+        return ( this->numOutstandingRequests == 0 );
+    });
+}
+
+void StreamMan::NativeChannelWaitForResourceCompletion( Channel *channel, ident_t id ) const
+{
+    std::unique_lock <std::mutex> lockWaitActive( channel->lockReqProcess );
+
+    channel->condReqProcess.wait( lockWaitActive,
+        [&]
+    {
+        // Being worked on?
+        if ( channel->IsChannelProcessing( id ) )
+        {
+            return false;
+        }
+
+        // Nothing to worry about anymore!
+        return true;
+    });
+}
+
+bool StreamMan::NativeWaitForResourceActivity( ident_t id ) const
+{
+    // Wait until the resource has left the request queue, then wait for
+    // the channel that is processing it (if it even is being processed).
+
+    bool didWait = false;
+
+    {
+        std::unique_lock <std::mutex> ctxWaitQueue( this->lockRequestQueue );
+
+        if ( this->requestQueue.IsQueued( id ) || NativeIsInReadStage( id ) || NativeIsParked( id ) )
+        {
+            didWait = true;
+
+            this->condQueueUpdate.wait( ctxWaitQueue,
+                [&]
+            {
+                return ( this->requestQueue.IsQueued( id ) == false && NativeIsInReadStage( id ) == false && NativeIsParked( id ) == false );
+            });
+        }
+    }
+
+    // Channels register their activity before a request leaves the queue, so we cannot miss it.
+    Channel *waitForChannel = NULL;
+
+    for ( Channel *channel : this->channels )
+    {
+        if ( channel->IsChannelProcessing( id ) )
+        {
+            waitForChannel = channel;
+            break;
+        }
+    }
+
+    if ( waitForChannel )
+    {
+        didWait = true;
+
+        NativeChannelWaitForResourceCompletion( waitForChannel, id );
+    }
+
+    return didWait;
+}
+
+bool StreamMan::Request( ident_t id, float priority, ticket_t *ticketOut )
+{
+    // Don't allow requests if we are terminating.
+    if ( isTerminating )
+        return false;
+
+    // Send this resource loading request to an available Channel.
+    // Channels take loading requests on their own threads and provide data to the engine.
+
+    ticket_t ticket;
+
+    if ( ticketOut )
+    {
+        ticket = std::make_shared <RequestTicket> ( id );
+    }
+
+    bool isLoaded = false;
+    {
+        shared_lock_acquire <std::shared_timed_mutex> ctxChannelConsistency( this->lockResourceContest );
+
+        Resource *theRes = this->GetResourceAtID( id );
+
+        // Cannot load what we do not know about.
+        if ( theRes == NULL )
+            return false;
+
+        TraceEvent( StreamingTraceRecord::eType::REQUEST, id, GetTraceFloatArg( priority ), ( ticketOut != NULL ? 1 : 0 ) );
+
+        // Somebody wants this resource, so it should not be evicted anytime soon.
+        TouchResource( theRes->slot );
+
+        // A load that is being processed right now must not be called off by an earlier cancellation.
+        theRes->MarkLoadWanted();
+
+        // Attaching the ticket and queueing the request must happen together,
+        // so that channels do not think that nobody is going to load this resource.
+        std::unique_lock <std::mutex> ctxAttachTicket( this->lockTickets, std::defer_lock );
+
+        if ( ticket )
+        {
+            ctxAttachTicket.lock();
+        }
+
+        eResourceStatus status = theRes->status;
+
+        if ( status == eResourceStatus::LOADED )
+        {
+            isLoaded = true;
+        }
+        else
+        {
+            if ( ticket )
+            {
+                theRes->waitingTickets.push_back( ticket );
+            }
+
+            // The runtime asks for resources every frame until they are loaded.
+            // Do not bother the queue if a channel is already taking care of it.
+            if ( status != eResourceStatus::LOADING && status != eResourceStatus::BUFFERING )
+            {
+                Channel::request_t newRequest;
+                newRequest.reqType = Channel::eRequestType::LOAD;
+                newRequest.resID = id;
+
+                // Queued requests are merged, so this does not allocate anything.
+                NativePushStreamingRequest( newRequest, theRes, priority );
+            }
+        }
+    }
+
+    if ( ticket )
+    {
+        // Nothing to wait for.
+        if ( isLoaded )
+        {
+            ticket->Complete( true );
+        }
+
+        *ticketOut = std::move( ticket );
+    }
+
+    return true;
+}
+
+bool StreamMan::Unload( ident_t id )
+{
+    // We do not want to handle unloading on the main thread, because it might be pretty heavy too!
+
+    TraceEvent( StreamingTraceRecord::eType::UNLOAD, id );
+
+    shared_lock_acquire <std::shared_timed_mutex> ctxChannelConsistency( this->lockResourceContest );
+    
+    Channel::request_t newRequest;
+    newRequest.reqType = Channel::eRequestType::UNLOAD;
+    newRequest.resID = id;
+
+    NativePushStreamingRequest( newRequest, this->GetResourceAtID( id ), 0.0f );
+
+    return true;
+}
+
+size_t StreamMan::Request( const ident_t *ids, size_t numIDs, const float *priorities )
+{
+    if ( isTerminating )
+        return 0;
+
+    size_t numRequested = 0;
+    size_t numNewRequests = 0;
+
+    {
+        shared_lock_acquire <std::shared_timed_mutex> ctxChannelConsistency( this->lockResourceContest );
+
+        std::unique_lock <std::mutex> ctxPushRequests( this->lockRequestQueue );
+
+        for ( size_t n = 0; n < numIDs; n++ )
+        {
+            Resource *theRes = this->GetResourceAtID( ids[ n ] );
+
+            if ( theRes == NULL )
+                continue;
+
+            float priority = ( priorities ? priorities[ n ] : 0.0f );
+
+            TraceEvent( StreamingTraceRecord::eType::REQUEST, ids[ n ], GetTraceFloatArg( priority ) );
+
+            TouchResource( theRes->slot );
+
+            theRes->MarkLoadWanted();
+
+            numRequested++;
+
+            // Same as single requests, see above.
+            eResourceStatus status = theRes->status;
+
+            if ( status != eResourceStatus::LOADED && status != eResourceStatus::LOADING && status != eResourceStatus::BUFFERING )
+            {
+                Channel::request_t newRequest;
+                newRequest.reqType = Channel::eRequestType::LOAD;
+                newRequest.resID = ids[ n ];
+
+                numNewRequests += NativeQueueRequestNoLock( newRequest, theRes, priority );
+            }
+        }
+    }
+
+    NativeQueueRequests( numNewRequests, numNewRequests );
+
+    return numRequested;
+}
+
+size_t StreamMan::Unload( const ident_t *ids, size_t numIDs )
+{
+    size_t numNewRequests = 0;
+
+    {
+        shared_lock_acquire <std::shared_timed_mutex> ctxChannelConsistency( this->lockResourceContest );
+
+        std::unique_lock <std::mutex> ctxPushRequests( this->lockRequestQueue );
+
+        for ( size_t n = 0; n < numIDs; n++ )
+        {
+            TraceEvent( StreamingTraceRecord::eType::UNLOAD, ids[ n ] );
+
+            Channel::request_t newRequest;
+            newRequest.reqType = Channel::eRequestType::UNLOAD;
+            newRequest.resID = ids[ n ];
+
+            numNewRequests += NativeQueueRequestNoLock( newRequest, this->GetResourceAtID( ids[ n ] ), 0.0f );
+        }
+    }
+
+    NativeQueueRequests( numNewRequests, 0 );
+
+    return numIDs;
+}
+
+bool StreamMan::CancelRequest( ident_t id )
+{
+    bool hasCancelled = false;
+
+    std::vector <std::pair <ticket_t, bool>> cancelledTickets;
+    {
+        shared_lock_acquire <std::shared_timed_mutex> ctxChannelConsistency( this->lockResourceContest );
+
+        Resource *theRes = this->GetResourceAtID( id );
+
+        if ( theRes == NULL )
+            return false;
+
+        TraceEvent( StreamingTraceRecord::eType::CANCEL, id );
+
+        std::unique_lock <std::mutex> ctxTakeTickets( this->lockTickets );
+
+        std::unique_lock <std::mutex> ctxCancelLoad( this->lockRequestQueue );
+
+        // Loads that have left the queue already see this before they give anything to the runtime.
+        theRes->loadGeneration++;
+
+        bool hasTakenBack = false;
+
+        if ( this->requestQueue.RemoveLoad( theRes ) )
+        {
+            this->numQueuedRequests--;
+
+            NativeFinishRequest();
+
+            hasTakenBack = true;
+        }
+        else if ( theRes->isParked )
+        {
+            NativeDropParkedLoad( theRes );
+
+            hasTakenBack = true;
+        }
+
+        if ( hasTakenBack )
+        {
+            this->numCancelledRequests++;
+
+            // Loads that are parked on this resource have to load it by themselves now.
+            NativeResumeDependentsNoLock( theRes );
+
+            this->condQueueUpdate.notify_all();
+
+            hasCancelled = true;
+        }
+        else
+        {
+            eResourceStatus status = theRes->status;
+
+            hasCancelled = ( theRes->isInReadStage || status == eResourceStatus::BUFFERING || status == eResourceStatus::LOADING );
         }
 
-        // Terminate some things about this resource.
-        resToUnload->refCount = 0;
+        if ( hasCancelled )
+        {
+            NativeTakeTickets( theRes, false, cancelledTickets );
+        }
     }
 
-    // Anything else?
+    NativeCompleteTickets( cancelledTickets );
 
-    assert( this->totalStreamingMemoryUsage == 0 );
+    return hasCancelled;
 }
 
-void StreamMan::NativePushChannelRequest( Channel *channel, Channel::request_t request )
+void StreamMan::LoadingBarrier( void )
 {
-    exclusive_lock_acquire <std::shared_timed_mutex> ctxPushChannelRequest( channel->channelLock );
-
-    assert( channel != NULL );
-
-    channel->requests.push_back( std::move( request ) );
+    // Wait until all requests have been processed by all channels.
+    // Requests that are queued while processing (like evictions) are included.
+    TraceEvent( StreamingTraceRecord::eType::LOADING_BARRIER, 0 );
 
-    // We have to lock the channel as active.
-    // This is required to properly wait until it has finished loading.
-    channel->isActive = true;
+    NativeWaitForAllRequests();
+}
 
-    // Notify the channel that a new request is available!
-    ReleaseSemaphore( channel->semRequestCount, 1, NULL );
+bool StreamMan::WaitForResource( ident_t id ) const
+{
+    return NativeWaitForResourceActivity( id );
 }
 
-StreamMan::Channel* StreamMan::NativePushStreamingRequest( Channel::request_t request )
+StreamMan::eResourceStatus StreamMan::GetResourceStatus( ident_t id ) const
 {
-    size_t channelCount = this->channels.size();
+    // Slots are never freed, so we do not need any lock here.
+    // Idents without a resource just stay UNLOADED.
+    resourceSlot_t *slot = this->resourceTable.GetSlot( id );
+
+    if ( slot )
+    {
+        // The runtime asks for the status of resources it is using (like visible models each frame),
+        // so we count this as a use of the resource. This is called a lot, so it must not advance the shared clock.
+        TouchResourceRelaxed( *slot );
 
-    unsigned int selChannel = ( this->currentChannelID++ % channelCount );
+        eResourceStatus status = slot->status.load( std::memory_order_acquire );
 
-    // Give this channel the request.
-    Channel *channel = this->channels[ selChannel ];
+        TraceEvent( StreamingTraceRecord::eType::QUERY_STATUS, id, (unsigned int)status );
 
-    NativePushChannelRequest( channel, std::move( request ) );
+        return status;
+    }
 
-    return channel;
+    // Dunno :(
+    return eResourceStatus::UNLOADED;
 }
 
-void StreamMan::NativeChannelWaitForCompletion( Channel *channel ) const
+void StreamMan::GetStatistics( StreamingStats& statsOut ) const
 {
-    std::unique_lock <std::mutex> lockWaitActive( channel->lockIsActive );
+    statsOut.maxMemory = this->maxMemory;
+    statsOut.memoryInUse = this->totalStreamingMemoryUsage;
+    statsOut.bufferMemoryInUse = this->bufferPool.GetMemoryInUse();
+    statsOut.bufferMemoryIdle = this->bufferPool.GetIdleMemory();
+    statsOut.rawCacheMemoryInUse = this->rawCache.GetMemoryInUse();
+    statsOut.rawCacheMaxMemory = this->rawCache.GetMaxMemory();
+    statsOut.rawCacheDataSize = this->rawCache.GetRawDataSize();
+    statsOut.numRawCacheHits = this->rawCache.GetNumHits();
+    statsOut.numRawCacheMisses = this->rawCache.GetNumMisses();
+    statsOut.numPendingDestructions = this->destructionQueue.GetNumPending();
+    statsOut.pendingDestructionMemory = this->destructionQueue.GetPendingMemory();
+    statsOut.numCancelledRequests = this->numCancelledRequests;
+    statsOut.numAbandonedLoads = this->numAbandonedLoads;
+    statsOut.numQueuedRequests = this->numQueuedRequests;
+    statsOut.numParkedLoads = this->numParkedLoads;
+    statsOut.numOutstandingRequests = this->numOutstandingRequests;
+    statsOut.numFailedLoads = this->numFailedLoads;
+    statsOut.numFaultRecoveries = this->numFaultRecoveries;
+
+    statsOut.channels.resize( this->channels.size() );
+
+    for ( size_t n = 0; n < this->channels.size(); n++ )
+    {
+        const Channel *channel = this->channels[ n ];
 
-    channel->condIsActive.wait( lockWaitActive,
-        [&]
+        statsOut.channels[ n ].bytesLoaded = channel->bytesLoaded;
+        statsOut.channels[ n ].busyTime = channel->busyTime;
+    }
+
+    statsOut.types.clear();
+
+    shared_lock_acquire <std::shared_timed_mutex> ctxTypeStats( this->lockStreamingTypeMutate );
+
+    for ( const reg_streaming_type& typeInfo : this->types )
     {
-        shared_lock_acquire <std::shared_timed_mutex> ctxChannelConsistency( channel->channelLock );
+        StreamingTypeStats typeStats;
 
-        return ( ! ( channel->requests.empty() == false || channel->isActive ) );
-    });
+        NativeGetTypeStatistics( typeInfo, typeStats );
+
+        statsOut.types.push_back( typeStats );
+    }
 }
 
-void StreamMan::NativeChannelWaitForResourceCompletion( Channel *channel, ident_t id ) const
+void StreamMan::ResetStatistics( void )
 {
-    std::unique_lock <std::mutex> lockWaitActive( channel->lockReqProcess );
+    this->numCancelledRequests = 0;
+    this->numAbandonedLoads = 0;
+    this->numFailedLoads = 0;
+    this->numFaultRecoveries = 0;
 
-    channel->condReqProcess.wait( lockWaitActive,
-        [&]
-    {
-        shared_lock_acquire <std::shared_timed_mutex> ctxChannelConsistency( channel->channelLock );
+    this->rawCache.ResetStatistics();
 
-        // Check if a certain resource is being in-the-queue or being worked on.
-        for ( const Channel::request_t& req : channel->requests )
-        {
-            if ( req.resID == id )
-            {
-                // Wait.
-                return false;
-            }
-        }
+    for ( Channel *channel : this->channels )
+    {
+        channel->bytesLoaded = 0;
+        channel->busyTime = 0;
+    }
 
-        // Being worked on?
-        if ( channel->IsChannelProcessingNoLock( id ) )
-        {
-            return false;
-        }
+    shared_lock_acquire <std::shared_timed_mutex> ctxTypeStats( this->lockStreamingTypeMutate );
 
-        // Nothing to worry about anymore!
-        return true;
-    });
+    for ( reg_streaming_type& typeInfo : this->types )
+    {
+        typeInfo.queueWaitTime.Reset();
+        typeInfo.ioTime.Reset();
+        typeInfo.decodeTime.Reset();
+    }
 }
 
-bool StreamMan::NativeWaitForResourceActivity( ident_t id ) const
+void StreamMan::StartTrace( StreamingTraceRecorder::writer_t writer )
 {
-    // Determine which channel is currently processing this resource (if it even is being processed)
-    // and wait for that channel to complete work.
+    std::unique_ptr <StreamingTraceRecorder> recorder( new StreamingTraceRecorder( std::move( writer ) ) );
 
-    Channel *waitForChannel = NULL;
+    // Nothing may be linked or registered while we write down the current state,
+    // else the trace could miss it.
+    // Same lock order as the channels.
+    shared_lock_acquire <std::shared_timed_mutex> ctxTraceResources( this->lockResourceAvail );
+
+    shared_lock_acquire <std::shared_timed_mutex> ctxTraceDependencies( this->lockDependsMutate );
+
+    shared_lock_acquire <std::shared_timed_mutex> ctxTraceTypes( this->lockStreamingTypeMutate );
+
+    size_t maxMemory = this->maxMemory;
 
-    // Try to get the channel from the queue of any worker thread.
+    recorder->Record( StreamingTraceRecord::eType::BEGIN, 0, StreamingTraceRecord::VERSION, (unsigned int)this->channels.size(), (unsigned int)this->ioWorkers.size() );
+    recorder->Record( StreamingTraceRecord::eType::SET_MAX_MEMORY, 0, (unsigned int)( (unsigned long long)maxMemory & 0xFFFFFFFF ), (unsigned int)( (unsigned long long)maxMemory >> 32 ) );
+
+    for ( const reg_streaming_type& typeInfo : this->types )
     {
-        for ( Channel *channel : this->channels )
+        recorder->Record( StreamingTraceRecord::eType::REGISTER_TYPE, typeInfo.base, (unsigned int)typeInfo.range );
+    }
+
+    this->resourceTable.ForAllResources(
+        [&]( Resource *res )
         {
-            shared_lock_acquire <std::shared_timed_mutex> ctxCheckChannelQueue( channel->channelLock );
+            recorder->Record( StreamingTraceRecord::eType::LINK, res->id, GetTraceArg( res->resourceSize ) );
+        }
+    );
 
-            for ( const Channel::request_t req : channel->requests )
+    // Dependencies need both ends to be linked.
+    this->resourceTable.ForAllResources(
+        [&]( Resource *res )
+        {
+            for ( Resource *dependency : res->depends )
             {
-                if ( req.resID == id )
-                {
-                    // That channel has some business to do with this resource, so lets wait till it has finished said business.
-                    waitForChannel = channel;
-                }
+                recorder->Record( StreamingTraceRecord::eType::ADD_DEPENDENCY, res->id, (unsigned int)dependency->id );
+            }
+
+            if ( res->status == eResourceStatus::LOADED )
+            {
+                recorder->Record( StreamingTraceRecord::eType::RESIDENT, res->id );
             }
         }
-    }
+    );
 
-    if ( waitForChannel == NULL )
+    std::unique_ptr <StreamingTraceRecorder> oldRecorder;
     {
-        shared_lock_acquire <std::shared_timed_mutex> ctxCheckResourceWorker( this->lockResourceContest );
+        std::unique_lock <std::mutex> ctxStartTrace( this->lockTrace );
 
-        // Attempt to get the worker channel from the resource itself.
-        const Resource *resToCheck = this->GetConstResourceAtID( id );
+        oldRecorder = std::move( this->traceRecorder );
 
-        eResourceStatus resStatus = resToCheck->status;
+        this->traceRecorder = std::move( recorder );
 
-        if ( resStatus != eResourceStatus::UNLOADED && resStatus != eResourceStatus::LOADED )
-        {
-            // We want to wait for the channel that works on this to complete things.
-            waitForChannel = resToCheck->syncOwner;
-        }
+        this->isTracing = true;
     }
 
-    bool didWait = false;
+    // The old trace is flushed when it goes away.
+}
 
-    if ( waitForChannel )
+void StreamMan::StopTrace( void )
+{
+    std::unique_ptr <StreamingTraceRecorder> oldRecorder;
     {
-        didWait = true;
+        std::unique_lock <std::mutex> ctxStopTrace( this->lockTrace );
 
-        NativeChannelWaitForResourceCompletion( waitForChannel, id );
+        this->isTracing = false;
+
+        oldRecorder = std::move( this->traceRecorder );
     }
 
-    return didWait;
+    // Flushed by its destructor, outside of the lock.
 }
 
-bool StreamMan::Request( ident_t id )
+void StreamMan::NativeTraceEvent( StreamingTraceRecord::eType type, ident_t id, unsigned int arg0, unsigned int arg1, unsigned int arg2, unsigned int arg3 ) const
 {
-    // Don't allow requests if we are terminating.
-    if ( isTerminating )
-        return false;
+    std::unique_lock <std::mutex> ctxRecordEvent( this->lockTrace );
 
-    // Send this resource loading request to an available Channel.
-    // Channels take loading requests on their own threads and provide data to the engine.
+    if ( this->traceRecorder )
+    {
+        this->traceRecorder->Record( type, id, arg0, arg1, arg2, arg3 );
+    }
+}
 
-    shared_lock_acquire <std::shared_timed_mutex> ctxChannelConsistency( this->lockResourceContest );
+// only THREAD-SAFE if called from lockStreamingTypeMutate !
+void StreamMan::NativeGetTypeStatistics( const reg_streaming_type& typeInfo, StreamingTypeStats& statsOut ) const
+{
+    statsOut.base = typeInfo.base;
+    statsOut.range = typeInfo.range;
+    statsOut.memoryInUse = typeInfo.memoryInUse;
+    statsOut.numLoadedResources = typeInfo.numLoadedResources;
+
+    typeInfo.queueWaitTime.GetSnapshot( statsOut.queueWaitTime );
+    typeInfo.ioTime.GetSnapshot( statsOut.ioTime );
+    typeInfo.decodeTime.GetSnapshot( statsOut.decodeTime );
+}
 
-    Channel::request_t newRequest;
-    newRequest.reqType = Channel::eRequestType::LOAD;
-    newRequest.resID = id;
+bool StreamMan::GetTypeStatistics( ident_t base, StreamingTypeStats& statsOut ) const
+{
+    shared_lock_acquire <std::shared_timed_mutex> ctxTypeStats( this->lockStreamingTypeMutate );
 
-    NativePushStreamingRequest( newRequest );
+    const reg_streaming_type *typeInfo = GetStreamingTypeAtID( base );
+
+    if ( typeInfo == NULL || typeInfo->base != base )
+        return false;
+
+    NativeGetTypeStatistics( *typeInfo, statsOut );
 
     return true;
 }
 
-bool StreamMan::Unload( ident_t id )
+void StreamMan::SetMaxMemory( size_t maxMemory )
 {
-    // We do not want to handle unloading on the main thread, because it might be pretty heavy too!
+    if ( this->maxMemory == maxMemory )
+        return;
 
-    shared_lock_acquire <std::shared_timed_mutex> ctxChannelConsistency( this->lockResourceContest );
-    
-    Channel::request_t newRequest;
-    newRequest.reqType = Channel::eRequestType::UNLOAD;
-    newRequest.resID = id;
+    this->maxMemory = maxMemory;
 
-    NativePushStreamingRequest( newRequest );
+    TraceEvent( StreamingTraceRecord::eType::SET_MAX_MEMORY, 0, (unsigned int)( (unsigned long long)maxMemory & 0xFFFFFFFF ), (unsigned int)( (unsigned long long)maxMemory >> 32 ) );
 
-    return true;
+    // We could be over budget now.
+    EnforceMemoryBudget();
 }
 
-bool StreamMan::CancelRequest( ident_t id )
+void StreamMan::DeferDestruction( StreamingDestructionQueue::destructor_t destructor, size_t memorySize )
 {
-    // TODO: allow requests to be cancelled.
-    // does not have to work in all cases.
+    this->destructionQueue.Push( std::move( destructor ), memorySize );
+}
 
-    return false;
+size_t StreamMan::RunDeferredDestructions( unsigned long long timeBudget )
+{
+    return this->destructionQueue.Run( timeBudget );
 }
 
-void StreamMan::LoadingBarrier( void )
+void StreamMan::RunAllDeferredDestructions( void )
 {
-    // Wait until all requests have been processed by all channels.
+    this->destructionQueue.RunAll();
+}
+
+void StreamMan::SetDestructionThread( bool isEnabled )
+{
+    this->destructionQueue.SetBackgroundThread( isEnabled );
+}
+
+void StreamMan::SetRawCacheMemory( size_t maxMemory, bool isCompressed )
+{
+    this->rawCache.SetCompression( isCompressed );
 
-    // Check all channels.
-    for ( Channel *curChannel : this->channels )
+    if ( this->rawCache.GetMaxMemory() != maxMemory )
     {
-        NativeChannelWaitForCompletion( curChannel );
+        this->rawCache.SetMaxMemory( maxMemory );
     }
 }
 
-bool StreamMan::WaitForResource( ident_t id ) const
+// only THREAD-SAFE if called from lockTickets !
+void StreamMan::NativeTakeTickets( Resource *res, bool hasSucceeded, std::vector <std::pair <ticket_t, bool>>& ticketsOut )
 {
-    return NativeWaitForResourceActivity( id );
+    for ( ticket_t& ticket : res->waitingTickets )
+    {
+        ticketsOut.push_back( std::make_pair( std::move( ticket ), hasSucceeded ) );
+    }
+
+    res->waitingTickets.clear();
 }
 
-StreamMan::eResourceStatus StreamMan::GetResourceStatus( ident_t id ) const
+// must be called WITHOUT any streaming locks held, because callbacks can call back into the streaming system.
+void StreamMan::NativeCompleteTickets( std::vector <std::pair <ticket_t, bool>>& tickets )
 {
-    shared_lock_acquire <std::shared_timed_mutex> ctxResourceStateFetch( this->lockResourceContest );
+    for ( std::pair <ticket_t, bool>& finished : tickets )
+    {
+        finished.first->Complete( finished.second );
+    }
+
+    tickets.clear();
+}
 
-    const Resource *theRes = this->GetConstResourceAtID( id );
+void StreamMan::ClearEvictionPending( Resource *res )
+{
+    std::unique_lock <std::mutex> ctxEvictionState( this->lockEviction );
 
-    if ( theRes )
+    if ( res->isEvictionPending )
     {
-        return theRes->status;
-    }
+        res->isEvictionPending = false;
 
-    // Dunno :(
-    return eResourceStatus::UNLOADED;
+        this->pendingEvictionMemory -= res->pendingEvictionSize;
+    }
 }
 
-void StreamMan::GetStatistics( StreamingStats& statsOut ) const
+void StreamMan::EnforceMemoryBudget( void )
 {
-    statsOut.maxMemory = this->maxMemory;
-    statsOut.memoryInUse = this->totalStreamingMemoryUsage;
+    // Nothing should be unloaded behind the back of the destructor.
+    if ( this->isTerminating )
+        return;
+
+    size_t maxMemory = this->maxMemory;
+
+    size_t highWatermark = ( maxMemory / 100 ) * STREAMING_EVICTION_HIGH_WATERMARK;
+    size_t lowWatermark = ( maxMemory / 100 ) * STREAMING_EVICTION_LOW_WATERMARK;
+
+    // Quick check without taking any locks.
+    // Memory that is about to be freed by already queued evictions does not count.
+    {
+        size_t memoryUsage = this->totalStreamingMemoryUsage;
+        size_t pendingMemory = this->pendingEvictionMemory;
+
+        if ( memoryUsage <= pendingMemory || ( memoryUsage - pendingMemory ) <= highWatermark )
+            return;
+    }
+
+    shared_lock_acquire <std::shared_timed_mutex> ctxSelectVictims( this->lockResourceContest );
+
+    std::unique_lock <std::mutex> ctxEvictionState( this->lockEviction );
+
+    // Another thread could have selected victims before us.
+    size_t memoryUsage = this->totalStreamingMemoryUsage;
+    size_t pendingMemory = this->pendingEvictionMemory;
+
+    if ( memoryUsage <= pendingMemory )
+        return;
+
+    size_t projectedUsage = ( memoryUsage - pendingMemory );
+
+    if ( projectedUsage <= highWatermark )
+        return;
+
+    // Collect all resources that could be unloaded right now.
+    // Resources that are depended on by loaded resources have a refCount, so they stay pinned.
+    // The use times are copied, because requests and status queries keep changing them while we sort.
+    std::vector <std::pair <unsigned long long, Resource*>> victims;
+
+    this->resourceTable.ForAllResources(
+        [&] ( Resource *res )
+    {
+        if ( res->status == eResourceStatus::LOADED && res->refCount == 0 && res->isEvictionPending == false )
+        {
+            victims.push_back( std::make_pair( res->slot.lastUseTime.load( std::memory_order_relaxed ), res ) );
+        }
+    });
+
+    // Least recently used first.
+    std::sort( victims.begin(), victims.end(),
+        [] ( const std::pair <unsigned long long, Resource*>& left, const std::pair <unsigned long long, Resource*>& right )
+    {
+        return ( left.first < right.first );
+    });
+
+    for ( const auto& victimEntry : victims )
+    {
+        Resource *victim = victimEntry.second;
+
+        if ( projectedUsage <= lowWatermark )
+            break;
+
+        victim->isEvictionPending = true;
+
+        // The victim could be loaded again with a different size before its eviction is through.
+        victim->pendingEvictionSize = victim->residentSize;
+
+        this->pendingEvictionMemory += victim->pendingEvictionSize;
+
+        projectedUsage -= std::min( projectedUsage, victim->pendingEvictionSize );
+
+        Channel::request_t evictRequest;
+        evictRequest.reqType = Channel::eRequestType::UNLOAD;
+        evictRequest.resID = victim->id;
+        evictRequest.isEviction = true;
+
+        // Channels keep their evictions local.
+        NativePushStreamingRequest( std::move( evictRequest ), victim, 0.0f );
+    }
 }
 
 bool StreamMan::CheckTypeRegionConflict( ident_t base, ident_t range ) const
@@ -838,25 +3327,23 @@ bool StreamMan::CheckTypeRegionConflict( ident_t base, ident_t range ) const
 
 StreamMan::reg_streaming_type* StreamMan::GetStreamingTypeAtID( ident_t id )
 {
-    identSlice_t identSector( id, 1 );
+    // Every slot in the range of a type points at it.
+    resourceSlot_t *slot = this->resourceTable.GetSlot( id );
 
-    for ( reg_streaming_type& regType : this->types )
-    {
-        identSlice_t conflictRegion( regType.base, regType.range );
+    if ( slot == NULL )
+        return NULL;
 
-        identSlice_t::eIntersectionResult result =
-            identSector.intersectWith( conflictRegion );
+    return slot->typeInfo;
+}
 
-        // Basically, we only allow that the things are floating apart.
-        bool isFloatingApart = identSlice_t::isFloatingIntersect( result );
+const StreamMan::reg_streaming_type* StreamMan::GetStreamingTypeAtID( ident_t id ) const
+{
+    const resourceSlot_t *slot = this->resourceTable.GetSlot( id );
 
-        if ( !isFloatingApart )
-        {
-            return &regType;
-        }
-    }
+    if ( slot == NULL )
+        return NULL;
 
-    return NULL;
+    return slot->typeInfo;
 }
 
 void StreamMan::ClearResourcesAtSlot( ident_t resID, ident_t range )
@@ -867,7 +3354,7 @@ void StreamMan::ClearResourcesAtSlot( ident_t resID, ident_t range )
         ident_t curID = ( off + resID );
 
         // This is equivalent to unlinking it.
-        this->UnlinkResourceNative( curID, false );
+        this->UnlinkResourceNative( curID, true );
     }
 }
 
@@ -884,18 +3371,56 @@ bool StreamMan::RegisterResourceType( ident_t base, ident_t range, StreamingType
     if ( isConflict )
         return false;   // meow.
 
-    reg_streaming_type typeInfo;
-    typeInfo.manager = intf;
-    typeInfo.base = base;
-    typeInfo.range = range;
+    // The whole range has to fit into the resource table.
+    if ( base < 0 || range <= 0 || range > ( ResourceTable::PAGE_SIZE * ResourceTable::MAX_PAGES ) - base )
+        return false;
+
+    for ( ident_t off = 0; off < range; off++ )
+    {
+        if ( this->resourceTable.AllocateSlot( base + off ) == NULL )
+            return false;
+    }
+
+    this->types.emplace_back();
+
+    reg_streaming_type *regType = &this->types.back();
+    regType->manager = intf;
+    regType->base = base;
+    regType->range = range;
+    regType->memoryInUse = 0;
+    regType->numLoadedResources = 0;
+
+    for ( ident_t off = 0; off < range; off++ )
+    {
+        this->resourceTable.GetSlot( base + off )->typeInfo = regType;
+    }
 
-    this->types.push_back( std::move( typeInfo ) );
+    TraceEvent( StreamingTraceRecord::eType::REGISTER_TYPE, base, (unsigned int)range );
 
     return true;
 }
 
 bool StreamMan::UnregisterResourceType( ident_t base )
 {
+    // Loaded resources are unloaded by the channels, which need the type registry for that.
+    // So get rid of them before we lock the registry for ourselves.
+    {
+        ident_t typeBase, typeRange;
+        {
+            shared_lock_acquire <std::shared_timed_mutex> ctxFindType( this->lockStreamingTypeMutate );
+
+            const reg_streaming_type *streamType = GetStreamingTypeAtID( base );
+
+            if ( streamType == NULL )
+                return false;
+
+            typeBase = streamType->base;
+            typeRange = streamType->range;
+        }
+
+        ClearResourcesAtSlot( typeBase, typeRange );
+    }
+
     exclusive_lock_acquire <std::shared_timed_mutex> ctxUnregisterType( this->lockStreamingTypeMutate );
 
     // We get the streaming type at the given offset and unregister it.
@@ -904,11 +3429,18 @@ bool StreamMan::UnregisterResourceType( ident_t base )
     if ( streamType == NULL )
         return false;
 
-    // Clean up stuff.
-    ClearResourcesAtSlot( streamType->base, streamType->range );
+    // Resources that were linked in the meantime stay linked without a type,
+    // just like resources outside of any type. Unlinking them here would need lockResourceAvail,
+    // which must not be taken after lockStreamingTypeMutate.
+    TraceEvent( StreamingTraceRecord::eType::UNREGISTER_TYPE, streamType->base );
 
     // Erase us from the registry.
     {
+        for ( ident_t off = 0; off < streamType->range; off++ )
+        {
+            this->resourceTable.GetSlot( streamType->base + off )->typeInfo = NULL;
+        }
+
         // Yea, I do use auto for this project.
         auto typeIter = std::find( this->types.begin(), this->types.end(), *streamType );
 
@@ -928,22 +3460,22 @@ bool StreamMan::LinkResource( ident_t resID, std::string name, ResourceLocation
 
     exclusive_lock_acquire <std::shared_timed_mutex> ctxLinkResource( this->lockResourceContest );
 
-    // Is the slot already taken? Then fail.
+    // We want to occupy a Streaming Slot with actual resource data.
+    try
     {
-        resMap_t::const_iterator foundIter = this->resources.find( resID );
+        resourceSlot_t *slot = this->resourceTable.AllocateSlot( resID );
 
-        if ( foundIter != this->resources.end() )
+        // Is the slot already taken? Then fail.
+        if ( slot == NULL || slot->res != NULL )
         {
             return false;
         }
-    }
 
-    // We want to occupy a Streaming Slot with actual resource data.
-    try
-    {
-        Resource newLink( resID, std::move( name ), loc );
+        Resource *newLink = new Resource( resID, std::move( name ), loc, *slot );
+
+        slot->res.store( newLink, std::memory_order_release );
 
-        this->resources.insert( std::pair <ident_t, Resource> ( resID, std::move( newLink ) ) );
+        TraceEvent( StreamingTraceRecord::eType::LINK, resID, GetTraceArg( newLink->resourceSize ) );
     }
     catch( ... )
     {
@@ -963,11 +3495,10 @@ bool StreamMan::UnlinkResourceNative( ident_t resID, bool doLock )
     {
         shared_lock_acquire <std::shared_timed_mutex> ctxResourceDeinitialize( this->lockResourceAvail );
 
-        resMap_t::iterator iter = this->resources.find( resID );
+        Resource *res = GetResourceAtID( resID );
 
-        if ( iter != this->resources.end() )
+        if ( res != NULL )
         {
-            Resource *res = &iter->second;
 
             // Block this resource from transitioning into a loaded state.
             // This effectively prevents the loader from interfering with our unload-process.
@@ -986,14 +3517,12 @@ bool StreamMan::UnlinkResourceNative( ident_t resID, bool doLock )
                         unloadRequest.reqType = Channel::eRequestType::UNLOAD;
                         unloadRequest.resID = resID;
 
-                        Channel *reqChannel = NativePushStreamingRequest( std::move( unloadRequest ) );
-
-                        // Wait for it to finish unloading.
-                        if ( res->status != eResourceStatus::UNLOADED )
-                        {
-                            NativeChannelWaitForResourceCompletion( reqChannel, resID );
-                        }
+                        NativePushStreamingRequest( std::move( unloadRequest ), res, 0.0f );
                     }
+
+                    // Wait for it to finish unloading.
+                    // Channels set the status before they are done with the resource, so do not trust an UNLOADED status.
+                    NativeWaitForResourceActivity( resID );
                 }
 
                 // Checking for unloaded status is very important.
@@ -1003,6 +3532,9 @@ bool StreamMan::UnlinkResourceNative( ident_t resID, bool doLock )
                 // takes care of such a hazard.
                 if ( res->status == eResourceStatus::UNLOADED )
                 {
+                    // Evictions that are still queued in channels must not touch this resource anymore.
+                    ClearEvictionPending( res );
+
                     // Remove any dependencies from and to this resource.
                     {
                         exclusive_lock_acquire <std::shared_timed_mutex> ctxDependsMutate( this->lockDependsMutate );
@@ -1051,31 +3583,81 @@ bool StreamMan::UnlinkResourceNative( ident_t resID, bool doLock )
 
     bool hasUnlinked = false;
 
+    // Set if a channel has picked the resource up again before we could delete it.
+    bool isStillProcessed = false;
+
+    // The resource is gone, so its requests cannot succeed anymore.
+    std::vector <std::pair <ticket_t, bool>> orphanedTickets;
+
     // Delete the resource.
     // Note that another thread could have solved this problem before us.
     if ( canUnlink )
     {
         exclusive_lock_acquire <std::shared_timed_mutex> ctxResourceUnlink( this->lockResourceAvail );
 
-        resMap_t::iterator iter = this->resources.find( resID );
+        Resource *resToDelete = GetResourceAtID( resID );
+
+        // We need to grab this lock because resources could be tried to be accessed
+        // while we are erasing them. Erasing them under locks removes this risk.
+        if ( resToDelete != NULL && doLock )
+        {
+            this->lockResourceContest.lock();
+
+            // Channels keep using the resource until their activity is gone.
+            for ( Channel *channel : this->channels )
+            {
+                if ( channel->IsChannelProcessing( resID ) )
+                {
+                    isStillProcessed = true;
+                    break;
+                }
+            }
+
+            if ( isStillProcessed )
+            {
+                this->lockResourceContest.unlock();
+            }
+        }
 
-        if ( iter != this->resources.end() )
+        if ( resToDelete != NULL && isStillProcessed == false )
         {
-            Resource *resToDelete = &iter->second;
 
             assert( resToDelete->status == eResourceStatus::UNLOADED );
 
             assert( resToDelete->refCount == 0 );
 
-            // We need to grab this lock because resources could be tried to be accessed
-            // while we are erasing them. Erasing them under locks removes this risk.
-            if ( doLock )
+            // Queued requests must not point to this resource anymore.
+            {
+                std::unique_lock <std::mutex> ctxRemoveQueued( this->lockRequestQueue );
+
+                if ( this->requestQueue.RemoveLoad( resToDelete ) )
+                {
+                    this->numQueuedRequests--;
+
+                    NativeFinishRequest();
+                }
+
+                NativeRemoveFromReadStage( resToDelete, ctxRemoveQueued );
+
+                NativeDropParkedLoad( resToDelete );
+
+                // Loads that are parked on this resource cannot wait for it anymore.
+                NativeResumeDependentsNoLock( resToDelete );
+            }
+
             {
-                this->lockResourceContest.lock();
+                std::unique_lock <std::mutex> ctxTakeTickets( this->lockTickets );
+
+                NativeTakeTickets( resToDelete, false, orphanedTickets );
             }
 
             // OK!
-            this->resources.erase( iter );
+            resToDelete->slot.res = NULL;
+
+            delete resToDelete;
+
+            // Another resource could be linked at this ident.
+            this->rawCache.Remove( resID );
 
             if ( doLock )
             {
@@ -1086,12 +3668,27 @@ bool StreamMan::UnlinkResourceNative( ident_t resID, bool doLock )
         }
     }
 
+    // Try again once the channel is done with it.
+    if ( isStillProcessed )
+    {
+        return UnlinkResourceNative( resID, doLock );
+    }
+
+    NativeCompleteTickets( orphanedTickets );
+
     return hasUnlinked;
 }
 
 bool StreamMan::UnlinkResource( ident_t resID )
 {
-    return UnlinkResourceNative( resID, true );
+    bool hasUnlinked = UnlinkResourceNative( resID, true );
+
+    if ( hasUnlinked )
+    {
+        TraceEvent( StreamingTraceRecord::eType::UNLINK, resID );
+    }
+
+    return hasUnlinked;
 }
 
 bool StreamMan::AddResourceDependency( ident_t resID, ident_t dependsOn )
@@ -1155,6 +3752,8 @@ bool StreamMan::AddResourceDependency( ident_t resID, ident_t dependsOn )
                 // And of course register the dependency for loading.
                 srcResource->depends.push_back( dependency );
 
+                TraceEvent( StreamingTraceRecord::eType::ADD_DEPENDENCY, resID, (unsigned int)dependsOn );
+
                 success = true;
             }
         }
@@ -1199,6 +3798,8 @@ bool StreamMan::RemoveResourceDependency( ident_t resID, ident_t dependsOn )
             if ( success )
             {
                 dependency->RemoveDependingOnBackLink( srcResource );
+
+                TraceEvent( StreamingTraceRecord::eType::REMOVE_DEPENDENCY, resID, (unsigned int)dependsOn );
             }
         }
     }
@@ -358,6 +358,24 @@ struct StreamTypeUnloadFaulty : public streaming::StreamingTypeInterface
     }
 };
 
+struct StreamTypeCoolio : public streaming::StreamingTypeInterface
+{
+    void LoadResource( ident_t localID, const void *data, size_t dataSize ) override
+    {
+        //meow.
+    }
+
+    void UnloadResource( ident_t localID ) override
+    {
+        //meow.
+    }
+
+    size_t GetObjectMemorySize( ident_t localID ) const override
+    {
+        return 0;
+    }
+};
+
 // Test made in mind to raise as many errors as possible.
 void FaultTest1( void )
 {
@@ -451,6 +469,1246 @@ void FaultTest1( void )
     }
 }
 
+// Test whether the memory budget is kept by evicting least recently used resources.
+void EvictionTest1( void )
+{
+    StreamMan manager( 1 );
+
+    const ident_t numResources = 100;
+
+    std::vector <ResLocCoolio> resLocs( numResources );
+    StreamTypeCoolio streamType;
+
+    manager.RegisterResourceType( 0, numResources, &streamType );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.LinkResource( n, "eviction-" + std::to_string( n ), &resLocs[ n ] );
+    }
+
+    // Resource 1 must stay pinned for as long as resource 0 is loaded.
+    manager.AddResourceDependency( 0, 1 );
+
+    // Only give space for a few resources.
+    manager.SetMaxMemory( resLocs[ 0 ].getDataSize() * 20 );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.Request( n );
+    }
+
+    // Evictions are queued by the loading itself, so wait for them too.
+    manager.LoadingBarrier();
+    manager.LoadingBarrier();
+
+    {
+        streaming::StreamingStats stats;
+
+        manager.GetStatistics( stats );
+
+        assert( stats.memoryInUse <= stats.maxMemory );
+    }
+
+    if ( manager.GetResourceStatus( 0 ) == StreamMan::eResourceStatus::LOADED )
+    {
+        assert( manager.GetResourceStatus( 1 ) == StreamMan::eResourceStatus::LOADED );
+    }
+
+    // The most recently requested resource cannot have been evicted.
+    assert( manager.GetResourceStatus( numResources - 1 ) == StreamMan::eResourceStatus::LOADED );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.UnlinkResource( n );
+    }
+
+    manager.UnregisterResourceType( 0 );
+}
+
+// Takes its time to unload, so that requests can come in while it does.
+struct StreamTypeSlowUnload : public StreamTypeCoolio
+{
+    void LoadResource( ident_t localID, const void *data, size_t dataSize ) override
+    {
+        this->numLoads++;
+    }
+
+    void UnloadResource( ident_t localID ) override
+    {
+        this->isUnloading = true;
+
+        std::this_thread::sleep_for( std::chrono::milliseconds( 300 ) );
+    }
+
+    std::atomic <int> numLoads { 0 };
+    std::atomic <bool> isUnloading { false };
+};
+
+// Tickets have to report the outcome of exactly the request they were handed out for.
+void TicketTest1( void )
+{
+    StreamMan manager( 2 );
+
+    ResLocCoolio goodLoc;
+    ResLocFailFetch badLoc;
+    StreamTypeCoolio streamType;
+
+    manager.RegisterResourceType( 0, 2, &streamType );
+
+    manager.LinkResource( 0, "ticket-good", &goodLoc );
+    manager.LinkResource( 1, "ticket-bad", &badLoc );
+
+    std::atomic <int> numCallbacks( 0 );
+
+    ticket_t goodTicket, badTicket;
+
+    bool couldRequest = manager.Request( 0, 0.0f, &goodTicket );
+    assert( couldRequest == true );
+
+    couldRequest = manager.Request( 1, 0.0f, &badTicket );
+    assert( couldRequest == true );
+
+    goodTicket->OnCompletion(
+        [&] ( ident_t id, bool hasSucceeded )
+    {
+        assert( id == 0 && hasSucceeded == true );
+
+        numCallbacks++;
+    });
+
+    badTicket->OnCompletion(
+        [&] ( ident_t id, bool hasSucceeded )
+    {
+        assert( id == 1 && hasSucceeded == false );
+
+        numCallbacks++;
+    });
+
+    // Only wait for what we care about.
+    assert( goodTicket->Wait() == true );
+    assert( badTicket->Wait() == false );
+
+    assert( numCallbacks == 2 );
+
+    assert( manager.GetResourceStatus( 0 ) == StreamMan::eResourceStatus::LOADED );
+
+    // Loaded resources hand out finished tickets.
+    {
+        ticket_t loadedTicket;
+
+        manager.Request( 0, 0.0f, &loadedTicket );
+
+        assert( loadedTicket->IsDone() == true && loadedTicket->HasSucceeded() == true );
+    }
+
+    // Requests that come in while the resource is unloading have to load it again afterwards.
+    {
+        ResLocCoolio unloadingLoc;
+        StreamTypeSlowUnload slowType;
+
+        manager.RegisterResourceType( 2, 1, &slowType );
+
+        manager.LinkResource( 2, "ticket-unloading", &unloadingLoc );
+
+        ticket_t loadTicket;
+
+        manager.Request( 2, 0.0f, &loadTicket );
+
+        assert( loadTicket->Wait() == true );
+
+        manager.Unload( 2 );
+
+        while ( slowType.isUnloading == false )
+        {
+            std::this_thread::yield();
+        }
+
+        ticket_t reloadTicket;
+
+        couldRequest = manager.Request( 2, 0.0f, &reloadTicket );
+        assert( couldRequest == true );
+
+        assert( reloadTicket->Wait() == true );
+
+        assert( manager.GetResourceStatus( 2 ) == StreamMan::eResourceStatus::LOADED );
+        assert( slowType.numLoads == 2 );
+
+        manager.UnlinkResource( 2 );
+        manager.UnregisterResourceType( 2 );
+    }
+
+    manager.UnlinkResource( 0 );
+    manager.UnlinkResource( 1 );
+
+    // Unknown resources cannot be requested.
+    {
+        ticket_t unknownTicket;
+
+        couldRequest = manager.Request( 0, 0.0f, &unknownTicket );
+
+        assert( couldRequest == false && unknownTicket == NULL );
+    }
+
+    manager.UnregisterResourceType( 0 );
+}
+
+// Uses the data of its resources in place instead of copying it.
+struct StreamTypeInPlace : public streaming::StreamingTypeInterface
+{
+    void LoadResource( ident_t localID, const void *data, size_t dataSize ) override
+    {
+        this->keptData[ localID ] = (const char*)data;
+    }
+
+    void UnloadResource( ident_t localID ) override
+    {
+        // We must be able to use the data until now.
+        assert( memcmp( this->keptData[ localID ], "Hello world!", 12 ) == 0 );
+
+        this->keptData[ localID ] = NULL;
+    }
+
+    size_t GetObjectMemorySize( ident_t localID ) const override
+    {
+        return 0;
+    }
+
+    bool KeepsResourceData( void ) const override
+    {
+        return true;
+    }
+
+    const char *keptData[ 4 ] = { NULL };
+};
+
+// Buffers that are kept by streaming types have to go back to the pool once they unload.
+void BufferTest1( void )
+{
+    StreamMan manager( 2 );
+
+    ResLocCoolio resLocs[ 4 ];
+    StreamTypeInPlace streamType;
+
+    manager.RegisterResourceType( 0, 4, &streamType );
+
+    for ( ident_t n = 0; n < 4; n++ )
+    {
+        manager.LinkResource( n, "in-place-" + std::to_string( n ), &resLocs[ n ] );
+
+        manager.Request( n );
+    }
+
+    manager.LoadingBarrier();
+
+    for ( ident_t n = 0; n < 4; n++ )
+    {
+        assert( manager.GetResourceStatus( n ) == StreamMan::eResourceStatus::LOADED );
+
+        assert( memcmp( streamType.keptData[ n ], "Hello world!", 12 ) == 0 );
+    }
+
+    {
+        streaming::StreamingStats stats;
+
+        manager.GetStatistics( stats );
+
+        assert( stats.bufferMemoryInUse >= 4 * resLocs[ 0 ].getDataSize() );
+    }
+
+    for ( ident_t n = 0; n < 4; n++ )
+    {
+        manager.UnlinkResource( n );
+    }
+
+    manager.LoadingBarrier();
+
+    {
+        streaming::StreamingStats stats;
+
+        manager.GetStatistics( stats );
+
+        assert( stats.bufferMemoryInUse == 0 );
+    }
+
+    manager.UnregisterResourceType( 0 );
+}
+
+
+// Checks that all dependencies of a resource are there before it loads.
+struct StreamTypeDependent : public streaming::StreamingTypeInterface
+{
+    void LoadResource( ident_t localID, const void *data, size_t dataSize ) override
+    {
+        for ( ident_t n = 0; n < numDependencies; n++ )
+        {
+            assert( manager->GetResourceStatus( dependencyBase + n ) == StreamMan::eResourceStatus::LOADED );
+        }
+    }
+
+    void UnloadResource( ident_t localID ) override
+    {
+        //meow.
+    }
+
+    size_t GetObjectMemorySize( ident_t localID ) const override
+    {
+        return 0;
+    }
+
+    StreamMan *manager = NULL;
+    ident_t dependencyBase = 0;
+    ident_t numDependencies = 0;
+};
+
+// Dependencies are loaded by other channels while the loads that need them are parked.
+void DependencyTest1( void )
+{
+    StreamMan manager( 4 );
+
+    const ident_t numParents = 8;
+    const ident_t numDependencies = 8;
+
+    std::vector <ResLocCoolio> resLocs( numParents + numDependencies );
+    StreamTypeDependent parentType;
+    StreamTypeCoolio dependencyType;
+
+    parentType.manager = &manager;
+    parentType.dependencyBase = numParents;
+    parentType.numDependencies = numDependencies;
+
+    manager.RegisterResourceType( 0, numParents, &parentType );
+    manager.RegisterResourceType( numParents, numDependencies, &dependencyType );
+
+    for ( ident_t n = 0; n < ( numParents + numDependencies ); n++ )
+    {
+        manager.LinkResource( n, "dependency-" + std::to_string( n ), &resLocs[ n ] );
+    }
+
+    // Every parent needs all of the dependencies.
+    for ( ident_t parent = 0; parent < numParents; parent++ )
+    {
+        for ( ident_t n = 0; n < numDependencies; n++ )
+        {
+            manager.AddResourceDependency( parent, numParents + n );
+        }
+    }
+
+    std::vector <ticket_t> tickets( numParents );
+
+    for ( ident_t parent = 0; parent < numParents; parent++ )
+    {
+        manager.Request( parent, (float)parent, &tickets[ parent ] );
+    }
+
+    for ( ident_t parent = 0; parent < numParents; parent++ )
+    {
+        assert( tickets[ parent ]->Wait() == true );
+    }
+
+    manager.LoadingBarrier();
+
+    // Loaded parents keep their dependencies pinned.
+    for ( ident_t n = 0; n < numDependencies; n++ )
+    {
+        manager.Unload( numParents + n );
+    }
+
+    manager.LoadingBarrier();
+
+    for ( ident_t n = 0; n < numDependencies; n++ )
+    {
+        assert( manager.GetResourceStatus( numParents + n ) == StreamMan::eResourceStatus::LOADED );
+    }
+
+    for ( ident_t n = 0; n < ( numParents + numDependencies ); n++ )
+    {
+        manager.UnlinkResource( n );
+    }
+
+    manager.UnregisterResourceType( numParents );
+    manager.UnregisterResourceType( 0 );
+}
+
+// Takes its time, so that requests pile up behind it.
+struct ResLocSlow : public ResLocCoolio
+{
+    void fetchData( void *dataBuf ) override
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+
+        ResLocCoolio::fetchData( dataBuf );
+    }
+};
+
+// Cancelled requests must not load anything.
+void CancelTest1( void )
+{
+    StreamMan manager( 1, 0 );
+
+    const ident_t numResources = 16;
+
+    ResLocSlow slowLoc;
+    std::vector <ResLocCoolio> resLocs( numResources );
+    StreamTypeCoolio streamType;
+
+    manager.RegisterResourceType( 0, numResources + 1, &streamType );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.LinkResource( n, "cancel-" + std::to_string( n ), &resLocs[ n ] );
+    }
+
+    manager.LinkResource( numResources, "cancel-slow", &slowLoc );
+
+    // Keep the only channel busy while we queue.
+    manager.Request( numResources, -1.0f );
+
+    std::vector <ticket_t> tickets( numResources );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.Request( n, (float)n, &tickets[ n ] );
+    }
+
+    // Cancel every second request.
+    for ( ident_t n = 0; n < numResources; n += 2 )
+    {
+        manager.CancelRequest( n );
+    }
+
+    manager.LoadingBarrier();
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        bool isCancelled = ( ( n % 2 ) == 0 );
+
+        assert( tickets[ n ]->Wait() == !isCancelled );
+
+        if ( isCancelled )
+        {
+            assert( manager.GetResourceStatus( n ) == StreamMan::eResourceStatus::UNLOADED );
+        }
+    }
+
+    {
+        streaming::StreamingStats stats;
+
+        manager.GetStatistics( stats );
+
+        assert( stats.numCancelledRequests + stats.numAbandonedLoads >= ( numResources / 2 ) );
+    }
+
+    // Requesting again after cancelling has to work.
+    {
+        ticket_t ticket;
+
+        manager.Request( 0, 0.0f, &ticket );
+
+        assert( ticket->Wait() == true );
+    }
+
+    // Nothing to cancel anymore.
+    assert( manager.CancelRequest( 0 ) == false );
+
+    for ( ident_t n = 0; n <= numResources; n++ )
+    {
+        manager.UnlinkResource( n );
+    }
+
+    manager.UnregisterResourceType( 0 );
+}
+
+// Requesting a whole visibility set at once.
+void BatchTest1( void )
+{
+    StreamMan manager( 4 );
+
+    const ident_t numResources = 200;
+
+    std::vector <ResLocCoolio> resLocs( numResources );
+    StreamTypeCoolio streamType;
+
+    manager.RegisterResourceType( 0, numResources, &streamType );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.LinkResource( n, "batch-" + std::to_string( n ), &resLocs[ n ] );
+    }
+
+    std::vector <ident_t> visibleSet;
+    std::vector <float> distances;
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        visibleSet.push_back( n );
+        distances.push_back( (float)( numResources - n ) );
+    }
+
+    // Unknown resources are skipped.
+    visibleSet.push_back( numResources + 10 );
+    distances.push_back( 0.0f );
+
+    size_t numRequested = manager.Request( visibleSet.data(), visibleSet.size(), distances.data() );
+
+    assert( numRequested == numResources );
+
+    manager.LoadingBarrier();
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        assert( manager.GetResourceStatus( n ) == StreamMan::eResourceStatus::LOADED );
+    }
+
+    // Requesting loaded resources again does not queue anything.
+    manager.Request( visibleSet.data(), numResources );
+
+    manager.Unload( visibleSet.data(), numResources );
+
+    manager.LoadingBarrier();
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        assert( manager.GetResourceStatus( n ) == StreamMan::eResourceStatus::UNLOADED );
+    }
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.UnlinkResource( n );
+    }
+
+    manager.UnregisterResourceType( 0 );
+}
+
+// Pretends that every resource takes up more memory once it is loaded.
+struct StreamTypeBloated : public StreamTypeCoolio
+{
+    size_t GetObjectMemorySize( ident_t localID ) const override
+    {
+        return 1000;
+    }
+};
+
+// Budgets have to work with the resident size instead of the data size.
+void MemoryTest1( void )
+{
+    StreamMan manager( 2 );
+
+    const ident_t numResources = 10;
+
+    std::vector <ResLocCoolio> resLocs( numResources * 2 );
+    StreamTypeBloated bloatedType;
+    StreamTypeCoolio plainType;
+
+    manager.RegisterResourceType( 0, numResources, &bloatedType );
+    manager.RegisterResourceType( 100, numResources, &plainType );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.LinkResource( n, "bloated-" + std::to_string( n ), &resLocs[ n ] );
+        manager.LinkResource( 100 + n, "plain-" + std::to_string( n ), &resLocs[ numResources + n ] );
+    }
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.Request( n );
+        manager.Request( 100 + n );
+    }
+
+    manager.LoadingBarrier();
+
+    {
+        StreamingTypeStats bloatedStats, plainStats;
+
+        assert( manager.GetTypeStatistics( 0, bloatedStats ) == true );
+        assert( manager.GetTypeStatistics( 100, plainStats ) == true );
+
+        assert( bloatedStats.numLoadedResources == numResources );
+        assert( bloatedStats.memoryInUse == numResources * 1000 );
+
+        // Types that cannot tell are counted by their data size.
+        assert( plainStats.numLoadedResources == numResources );
+        assert( plainStats.memoryInUse == numResources * resLocs[ 0 ].getDataSize() );
+
+        streaming::StreamingStats stats;
+
+        manager.GetStatistics( stats );
+
+        assert( stats.memoryInUse == bloatedStats.memoryInUse + plainStats.memoryInUse );
+
+        // Not the base of a type.
+        assert( manager.GetTypeStatistics( 1, bloatedStats ) == false );
+    }
+
+    // Only a few of the bloated resources fit now.
+    manager.SetMaxMemory( 5000 );
+
+    manager.LoadingBarrier();
+    manager.LoadingBarrier();
+
+    {
+        streaming::StreamingStats stats;
+
+        manager.GetStatistics( stats );
+
+        assert( stats.memoryInUse <= stats.maxMemory );
+    }
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.UnlinkResource( n );
+        manager.UnlinkResource( 100 + n );
+    }
+
+    {
+        StreamingTypeStats bloatedStats;
+
+        manager.GetTypeStatistics( 0, bloatedStats );
+
+        assert( bloatedStats.memoryInUse == 0 && bloatedStats.numLoadedResources == 0 );
+    }
+
+    manager.UnregisterResourceType( 100 );
+    manager.UnregisterResourceType( 0 );
+}
+
+// Every load has to show up in the timings of its type.
+void TelemetryTest1( void )
+{
+    StreamMan manager( 2 );
+
+    const ident_t numResources = 50;
+
+    std::vector <ResLocCoolio> resLocs( numResources );
+    StreamTypeCoolio streamType;
+
+    manager.RegisterResourceType( 0, numResources, &streamType );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.LinkResource( n, "telemetry-" + std::to_string( n ), &resLocs[ n ] );
+    }
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.Request( n );
+    }
+
+    manager.LoadingBarrier();
+
+    {
+        streaming::StreamingStats stats;
+
+        manager.GetStatistics( stats );
+
+        assert( stats.numQueuedRequests == 0 );
+        assert( stats.numOutstandingRequests == 0 );
+        assert( stats.numFailedLoads == 0 );
+        assert( stats.channels.size() == 2 );
+        assert( stats.types.size() == 1 );
+
+        unsigned long long bytesLoaded = 0;
+
+        for ( const StreamingChannelStats& channelStats : stats.channels )
+        {
+            bytesLoaded += channelStats.bytesLoaded;
+        }
+
+        assert( bytesLoaded == numResources * resLocs[ 0 ].getDataSize() );
+
+        const StreamingTypeStats& typeStats = stats.types[ 0 ];
+
+        assert( typeStats.base == 0 && typeStats.range == numResources );
+        assert( typeStats.queueWaitTime.numSamples == numResources );
+        assert( typeStats.ioTime.numSamples == numResources );
+        assert( typeStats.decodeTime.numSamples == numResources );
+
+        assert( typeStats.queueWaitTime.GetPercentile( 0.5 ) <= typeStats.queueWaitTime.GetPercentile( 0.99 ) );
+        assert( typeStats.queueWaitTime.GetPercentile( 1.0 ) <= typeStats.queueWaitTime.maxTime );
+    }
+
+    manager.ResetStatistics();
+
+    {
+        StreamingTypeStats typeStats;
+
+        manager.GetTypeStatistics( 0, typeStats );
+
+        assert( typeStats.decodeTime.numSamples == 0 );
+
+        // Residency is not a statistic.
+        assert( typeStats.numLoadedResources == numResources );
+    }
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.UnlinkResource( n );
+    }
+
+    manager.UnregisterResourceType( 0 );
+}
+
+// Counts how often its data had to be read.
+struct ResLocCounted : public streaming::ResourceLocation
+{
+    inline ResLocCounted( void ) : numFetches( 0 )
+    {
+        return;
+    }
+
+    size_t getDataSize( void ) const override
+    {
+        return some_data.size();
+    }
+
+    void fetchData( void *dataBuf ) override
+    {
+        memcpy( dataBuf, some_data.c_str(), some_data.size() );
+
+        numFetches++;
+    }
+
+    std::string some_data;
+    std::atomic <unsigned int> numFetches;
+};
+
+// Makes sure that the data arrives untouched.
+struct StreamTypeChecked : public streaming::StreamingTypeInterface
+{
+    void LoadResource( ident_t localID, const void *data, size_t dataSize ) override
+    {
+        assert( dataSize == expected[ localID ]->size() );
+        assert( memcmp( data, expected[ localID ]->c_str(), dataSize ) == 0 );
+    }
+
+    void UnloadResource( ident_t localID ) override
+    {
+        //meow.
+    }
+
+    size_t GetObjectMemorySize( ident_t localID ) const override
+    {
+        return 0;
+    }
+
+    std::vector <const std::string*> expected;
+};
+
+void RawCacheTest1( void )
+{
+    StreamMan manager( 2 );
+
+    const ident_t numResources = 20;
+
+    std::vector <ResLocCounted> resLocs( numResources );
+    StreamTypeChecked checkedType;
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        // Some of it compresses, some of it does not.
+        for ( ident_t i = 0; i < 1000; i++ )
+        {
+            resLocs[ n ].some_data += ( n % 2 == 0 ) ? "meow " : std::to_string( ( i * 7919 + n ) % 251 );
+        }
+
+        checkedType.expected.push_back( &resLocs[ n ].some_data );
+    }
+
+    manager.RegisterResourceType( 0, numResources, &checkedType );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.LinkResource( n, "cached-" + std::to_string( n ), &resLocs[ n ] );
+    }
+
+    for ( int pass = 0; pass < 2; pass++ )
+    {
+        manager.SetRawCacheMemory( 1024 * 1024, ( pass == 1 ) );
+
+        for ( ident_t n = 0; n < numResources; n++ )
+        {
+            manager.Request( n );
+        }
+
+        manager.LoadingBarrier();
+
+        for ( ident_t n = 0; n < numResources; n++ )
+        {
+            manager.Unload( n );
+        }
+
+        manager.LoadingBarrier();
+
+        manager.ResetStatistics();
+
+        // Loading again must not read the data again.
+        for ( ident_t n = 0; n < numResources; n++ )
+        {
+            manager.Request( n );
+        }
+
+        manager.LoadingBarrier();
+
+        for ( ident_t n = 0; n < numResources; n++ )
+        {
+            assert( manager.GetResourceStatus( n ) == StreamMan::eResourceStatus::LOADED );
+            assert( resLocs[ n ].numFetches == (unsigned int)( pass + 1 ) );
+
+            manager.Unload( n );
+        }
+
+        manager.LoadingBarrier();
+
+        {
+            streaming::StreamingStats stats;
+
+            manager.GetStatistics( stats );
+
+            assert( stats.numRawCacheHits == numResources );
+            assert( stats.rawCacheMemoryInUse <= stats.rawCacheMaxMemory );
+
+            if ( pass == 1 )
+            {
+                assert( stats.rawCacheMemoryInUse < stats.rawCacheDataSize );
+            }
+        }
+
+        // Disabling the cache drops everything, so the next pass reads again.
+        manager.SetRawCacheMemory( 0 );
+    }
+
+    // Unlinking drops the data as well.
+    manager.SetRawCacheMemory( 1024 * 1024 );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.Request( n );
+    }
+
+    manager.LoadingBarrier();
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.UnlinkResource( n );
+    }
+
+    {
+        streaming::StreamingStats stats;
+
+        manager.GetStatistics( stats );
+
+        assert( stats.rawCacheMemoryInUse == 0 );
+    }
+
+    manager.UnregisterResourceType( 0 );
+}
+
+// Leaves the destruction of its objects to the streaming system.
+struct StreamTypeDeferred : public streaming::StreamingTypeInterface
+{
+    inline StreamTypeDeferred( StreamMan& manager, ident_t numObjects ) : manager( manager ), objects( numObjects ), numDestroyed( 0 )
+    {
+        return;
+    }
+
+    void LoadResource( ident_t localID, const void *data, size_t dataSize ) override
+    {
+        objects[ localID ].reset( new std::string( (const char*)data, dataSize ) );
+    }
+
+    void UnloadResource( ident_t localID ) override
+    {
+        std::string *object = objects[ localID ].release();
+
+        manager.DeferDestruction( [this, object] ()
+        {
+            delete object;
+
+            numDestroyed++;
+        }, object->size() );
+    }
+
+    size_t GetObjectMemorySize( ident_t localID ) const override
+    {
+        return objects[ localID ]->size();
+    }
+
+    StreamMan& manager;
+    std::vector <std::unique_ptr <std::string>> objects;
+    std::atomic <unsigned int> numDestroyed;
+};
+
+void DestructionTest1( void )
+{
+    StreamMan manager( 2 );
+
+    const ident_t numResources = 10;
+
+    std::vector <ResLocCounted> resLocs( numResources );
+    StreamTypeDeferred deferredType( manager, numResources );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        resLocs[ n ].some_data = std::string( 1000, 'a' + (char)n );
+    }
+
+    manager.RegisterResourceType( 0, numResources, &deferredType );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.LinkResource( n, "deferred-" + std::to_string( n ), &resLocs[ n ] );
+    }
+
+    for ( int pass = 0; pass < 2; pass++ )
+    {
+        bool isBackground = ( pass == 1 );
+
+        manager.SetDestructionThread( isBackground );
+
+        deferredType.numDestroyed = 0;
+
+        for ( ident_t n = 0; n < numResources; n++ )
+        {
+            manager.Request( n );
+        }
+
+        manager.LoadingBarrier();
+
+        for ( ident_t n = 0; n < numResources; n++ )
+        {
+            manager.Unload( n );
+        }
+
+        manager.LoadingBarrier();
+
+        // Unloading is done, but the objects only go away once the queue is run.
+        for ( ident_t n = 0; n < numResources; n++ )
+        {
+            assert( manager.GetResourceStatus( n ) == StreamMan::eResourceStatus::UNLOADED );
+        }
+
+        if ( isBackground == false )
+        {
+            streaming::StreamingStats stats;
+
+            manager.GetStatistics( stats );
+
+            assert( deferredType.numDestroyed == 0 );
+            assert( stats.numPendingDestructions == numResources );
+            assert( stats.pendingDestructionMemory == numResources * 1000 );
+
+            // Runs at least one, even without any time.
+            assert( manager.RunDeferredDestructions( 0 ) >= 1 );
+            assert( deferredType.numDestroyed >= 1 );
+        }
+
+        manager.RunAllDeferredDestructions();
+
+        // The background thread could still be busy with the last one.
+        while ( deferredType.numDestroyed != (unsigned int)numResources )
+        {
+            std::this_thread::yield();
+        }
+
+        {
+            streaming::StreamingStats stats;
+
+            manager.GetStatistics( stats );
+
+            assert( stats.numPendingDestructions == 0 );
+            assert( stats.pendingDestructionMemory == 0 );
+        }
+    }
+
+    manager.SetDestructionThread( false );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.UnlinkResource( n );
+    }
+
+    manager.UnregisterResourceType( 0 );
+}
+
+// Hands out its data in place, like a memory-mapped archive.
+struct ResLocMapped : public ResLocCounted
+{
+    inline ResLocMapped( void ) : numViews( 0 ), numReleasedViews( 0 )
+    {
+        return;
+    }
+
+    const void* acquireDataView( void ) override
+    {
+        numViews++;
+
+        return some_data.c_str();
+    }
+
+    void releaseDataView( const void *dataView ) override
+    {
+        assert( dataView == some_data.c_str() );
+
+        numReleasedViews++;
+    }
+
+    std::atomic <unsigned int> numViews;
+    std::atomic <unsigned int> numReleasedViews;
+};
+
+// Makes sure that the data was not copied.
+struct StreamTypeUncopied : public StreamTypeChecked
+{
+    void LoadResource( ident_t localID, const void *data, size_t dataSize ) override
+    {
+        assert( data == expected[ localID ]->c_str() );
+
+        StreamTypeChecked::LoadResource( localID, data, dataSize );
+    }
+};
+
+void MappedTest1( void )
+{
+    // The I/O worker must leave mapped data to the channels.
+    StreamMan manager( 2, 1 );
+
+    const ident_t numResources = 20;
+
+    std::vector <ResLocMapped> resLocs( numResources );
+    StreamTypeUncopied uncopiedType;
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        resLocs[ n ].some_data = std::string( 1000 + n, 'a' + (char)n );
+
+        uncopiedType.expected.push_back( &resLocs[ n ].some_data );
+    }
+
+    // Mapped data is not worth caching.
+    manager.SetRawCacheMemory( 1024 * 1024 );
+
+    manager.RegisterResourceType( 0, numResources, &uncopiedType );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.LinkResource( n, "mapped-" + std::to_string( n ), &resLocs[ n ] );
+    }
+
+    for ( int pass = 0; pass < 2; pass++ )
+    {
+        for ( ident_t n = 0; n < numResources; n++ )
+        {
+            manager.Request( n );
+        }
+
+        manager.LoadingBarrier();
+
+        for ( ident_t n = 0; n < numResources; n++ )
+        {
+            assert( manager.GetResourceStatus( n ) == StreamMan::eResourceStatus::LOADED );
+
+            manager.Unload( n );
+        }
+
+        manager.LoadingBarrier();
+    }
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        assert( resLocs[ n ].numFetches == 0 );
+        assert( resLocs[ n ].numViews >= 2 );
+        assert( resLocs[ n ].numViews == resLocs[ n ].numReleasedViews );
+    }
+
+    {
+        streaming::StreamingStats stats;
+
+        manager.GetStatistics( stats );
+
+        assert( stats.rawCacheMemoryInUse == 0 );
+    }
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.UnlinkResource( n );
+    }
+
+    manager.UnregisterResourceType( 0 );
+}
+
+// Disk that finishes its reads on its own thread, all of the pending ones at once.
+struct AsyncDisk
+{
+    inline AsyncDisk( void ) : isTerminating( false ), numInFlight( 0 ), maxInFlight( 0 )
+    {
+        this->diskThread = std::thread( [this] ()
+        {
+            std::unique_lock <std::mutex> ctxDisk( this->lockReads );
+
+            while ( this->isTerminating == false )
+            {
+                ctxDisk.unlock();
+
+                std::this_thread::sleep_for( std::chrono::milliseconds( 2 ) );
+
+                ctxDisk.lock();
+
+                std::vector <std::function <void ( void )>> finishedReads = std::move( this->pendingReads );
+
+                this->pendingReads.clear();
+
+                ctxDisk.unlock();
+
+                for ( std::function <void ( void )>& finishRead : finishedReads )
+                {
+                    finishRead();
+                }
+
+                ctxDisk.lock();
+            }
+        });
+    }
+
+    inline ~AsyncDisk( void )
+    {
+        {
+            std::unique_lock <std::mutex> ctxDisk( this->lockReads );
+
+            this->isTerminating = true;
+        }
+
+        this->diskThread.join();
+    }
+
+    void Read( std::function <void ( void )> finishRead )
+    {
+        std::unique_lock <std::mutex> ctxDisk( this->lockReads );
+
+        numInFlight++;
+
+        maxInFlight = std::max( maxInFlight, numInFlight );
+
+        this->pendingReads.push_back( [this, finishRead] ()
+        {
+            {
+                std::unique_lock <std::mutex> ctxDisk( this->lockReads );
+
+                numInFlight--;
+            }
+
+            finishRead();
+        });
+    }
+
+    std::mutex lockReads;
+    std::vector <std::function <void ( void )>> pendingReads;
+    bool isTerminating;
+
+    unsigned int numInFlight;
+    unsigned int maxInFlight;
+
+    std::thread diskThread;
+};
+
+struct ResLocAsync : public ResLocCounted
+{
+    inline ResLocAsync( void ) : disk( NULL )
+    {
+        return;
+    }
+
+    void fetchDataAsync( void *dataBuf, std::function <void ( bool )> onFetched ) override
+    {
+        disk->Read( [this, dataBuf, onFetched] ()
+        {
+            fetchData( dataBuf );
+
+            onFetched( true );
+        });
+    }
+
+    AsyncDisk *disk;
+};
+
+// Keeps the channel busy, so that the I/O worker gets to read.
+struct StreamTypeSlow : public StreamTypeChecked
+{
+    void LoadResource( ident_t localID, const void *data, size_t dataSize ) override
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+
+        StreamTypeChecked::LoadResource( localID, data, dataSize );
+    }
+};
+
+void AsyncReadTest1( void )
+{
+    AsyncDisk disk;
+
+    // Reads are only done asynchronously by the I/O worker.
+    StreamMan manager( 1, 1 );
+
+    const ident_t numResources = 40;
+
+    std::vector <ResLocAsync> resLocs( numResources );
+    StreamTypeSlow checkedType;
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        resLocs[ n ].disk = &disk;
+        resLocs[ n ].some_data = std::string( 500 + n, 'a' + (char)( n % 26 ) );
+
+        checkedType.expected.push_back( &resLocs[ n ].some_data );
+    }
+
+    manager.RegisterResourceType( 0, numResources, &checkedType );
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.LinkResource( n, "async-" + std::to_string( n ), &resLocs[ n ] );
+    }
+
+    // Queued in one go, so that the I/O worker can take many of them.
+    {
+        std::vector <ident_t> ids;
+
+        for ( ident_t n = 0; n < numResources; n++ )
+        {
+            ids.push_back( n );
+        }
+
+        manager.Request( ids.data(), ids.size() );
+    }
+
+    manager.LoadingBarrier();
+
+    unsigned int numFetches = 0;
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        assert( manager.GetResourceStatus( n ) == StreamMan::eResourceStatus::LOADED );
+
+        numFetches += resLocs[ n ].numFetches;
+    }
+
+    // Nothing is read twice.
+    assert( numFetches == (unsigned int)numResources );
+
+    // The I/O worker had more than one read in flight.
+
+    {
+        std::unique_lock <std::mutex> ctxDisk( disk.lockReads );
+
+        assert( disk.maxInFlight > 1 );
+    }
+
+    for ( ident_t n = 0; n < numResources; n++ )
+    {
+        manager.UnlinkResource( n );
+    }
+
+    manager.UnregisterResourceType( 0 );
+}
+
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "StdInc.h"
+#include "StreamingBufferPool.h"
+
+namespace krt
+{
+namespace streaming
+{
+
+void StreamingBuffer::Release( void )
+{
+    if ( this->data == NULL )
+        return;
+
+    this->pool->Free( this->data, this->size, this->sizeClass );
+
+    this->pool = NULL;
+    this->data = NULL;
+    this->size = 0;
+}
+
+StreamingBufferPool::StreamingBufferPool( size_t maxIdleMemory ) : memoryInUse( 0 ), idleMemory( 0 )
+{
+    this->maxIdleMemory = maxIdleMemory;
+}
+
+StreamingBufferPool::~StreamingBufferPool( void )
+{
+    // All buffers must have been given back by now.
+    assert( this->memoryInUse == 0 );
+
+    Trim();
+}
+
+StreamingBuffer StreamingBufferPool::Allocate( size_t size )
+{
+    // Find the smallest size class that fits.
+    unsigned int sizeClass = 0;
+
+    while ( sizeClass < NUM_SIZE_CLASSES && GetClassSize( sizeClass ) < size )
+    {
+        sizeClass++;
+    }
+
+    void *data = NULL;
+
+    if ( sizeClass < NUM_SIZE_CLASSES )
+    {
+        {
+            std::unique_lock <std::mutex> ctxTakeBuffer( this->lockFreeLists );
+
+            std::vector <void*>& freeList = this->freeLists[ sizeClass ];
+
+            if ( freeList.empty() == false )
+            {
+                data = freeList.back();
+
+                freeList.pop_back();
+
+                this->idleMemory -= GetClassSize( sizeClass );
+            }
+        }
+
+        if ( data == NULL )
+        {
+            data = ::operator new( GetClassSize( sizeClass ) );
+        }
+
+        this->memoryInUse += GetClassSize( sizeClass );
+    }
+    else
+    {
+        // Too big to be worth keeping around.
+        data = ::operator new( size );
+
+        this->memoryInUse += size;
+    }
+
+    StreamingBuffer buffer;
+    buffer.pool = this;
+    buffer.data = data;
+    buffer.size = size;
+    buffer.sizeClass = sizeClass;
+
+    return buffer;
+}
+
+void StreamingBufferPool::Free( void *data, size_t size, unsigned int sizeClass )
+{
+    if ( sizeClass >= NUM_SIZE_CLASSES )
+    {
+        this->memoryInUse -= size;
+
+        ::operator delete( data );
+        return;
+    }
+
+    size_t classSize = GetClassSize( sizeClass );
+
+    this->memoryInUse -= classSize;
+
+    {
+        std::unique_lock <std::mutex> ctxReturnBuffer( this->lockFreeLists );
+
+        if ( this->idleMemory + classSize <= this->maxIdleMemory )
+        {
+            this->freeLists[ sizeClass ].push_back( data );
+
+            this->idleMemory += classSize;
+
+            data = NULL;
+        }
+    }
+
+    // Over the cap, so just get rid of it.
+    if ( data )
+    {
+        ::operator delete( data );
+    }
+}
+
+void StreamingBufferPool::Trim( void )
+{
+    std::unique_lock <std::mutex> ctxTrim( this->lockFreeLists );
+
+    for ( unsigned int sizeClass = 0; sizeClass < NUM_SIZE_CLASSES; sizeClass++ )
+    {
+        std::vector <void*>& freeList = this->freeLists[ sizeClass ];
+
+        for ( void *data : freeList )
+        {
+            ::operator delete( data );
+        }
+
+        this->idleMemory -= ( freeList.size() * GetClassSize( sizeClass ) );
+
+        freeList.clear();
+    }
+}
+
+void StreamingBufferPool::SetMaxIdleMemory( size_t maxIdleMemory )
+{
+    std::unique_lock <std::mutex> ctxSetCap( this->lockFreeLists );
+
+    this->maxIdleMemory = maxIdleMemory;
+}
+
+}
+}
@@ -0,0 +1,156 @@
+#include "StdInc.h"
+#include "StreamingDestructionQueue.h"
+
+#include <chrono>
+
+namespace krt
+{
+namespace streaming
+{
+
+static unsigned long long GetDestructionTime( void )
+{
+    return (unsigned long long)std::chrono::duration_cast <std::chrono::microseconds> (
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+StreamingDestructionQueue::StreamingDestructionQueue( void ) : isThreadTerminating( false ), numPending( 0 ), pendingMemory( 0 )
+{
+    return;
+}
+
+StreamingDestructionQueue::~StreamingDestructionQueue( void )
+{
+    SetBackgroundThread( false );
+
+    RunAll();
+}
+
+void StreamingDestructionQueue::Push( destructor_t destructor, size_t memorySize )
+{
+    entry_t entry;
+    entry.destructor = std::move( destructor );
+    entry.memorySize = memorySize;
+
+    this->numPending++;
+    this->pendingMemory += memorySize;
+
+    {
+        std::unique_lock <std::mutex> ctxPushDestructor( this->lockQueue );
+
+        this->entries.push_back( std::move( entry ) );
+    }
+
+    this->condQueueUpdate.notify_one();
+}
+
+bool StreamingDestructionQueue::RunNext( void )
+{
+    entry_t entry;
+    {
+        std::unique_lock <std::mutex> ctxTakeDestructor( this->lockQueue );
+
+        if ( this->entries.empty() )
+            return false;
+
+        entry = std::move( this->entries.front() );
+
+        this->entries.pop_front();
+    }
+
+    try
+    {
+        entry.destructor();
+    }
+    catch( ... )
+    {
+        // The streaming system cannot do anything about errors of the runtime.
+    }
+
+    this->pendingMemory -= entry.memorySize;
+    this->numPending--;
+
+    return true;
+}
+
+size_t StreamingDestructionQueue::Run( unsigned long long timeBudget )
+{
+    const unsigned long long startTime = GetDestructionTime();
+
+    size_t numRun = 0;
+
+    while ( RunNext() )
+    {
+        numRun++;
+
+        if ( ( GetDestructionTime() - startTime ) >= timeBudget )
+            break;
+    }
+
+    return numRun;
+}
+
+void StreamingDestructionQueue::RunAll( void )
+{
+    while ( RunNext() );
+}
+
+void StreamingDestructionQueue::SetBackgroundThread( bool isEnabled )
+{
+    std::unique_lock <std::mutex> ctxChangeThread( this->lockThread );
+
+    if ( this->backgroundThread.joinable() == isEnabled )
+        return;
+
+    if ( isEnabled )
+    {
+        {
+            std::unique_lock <std::mutex> ctxStartThread( this->lockQueue );
+
+            this->isThreadTerminating = false;
+        }
+
+        this->backgroundThread = std::thread( [this] ()
+        {
+            BackgroundThreadRuntime();
+        });
+    }
+    else
+    {
+        {
+            std::unique_lock <std::mutex> ctxStopThread( this->lockQueue );
+
+            this->isThreadTerminating = true;
+        }
+
+        this->condQueueUpdate.notify_all();
+
+        this->backgroundThread.join();
+    }
+}
+
+void StreamingDestructionQueue::BackgroundThreadRuntime( void )
+{
+    while ( true )
+    {
+        {
+            std::unique_lock <std::mutex> ctxWaitForWork( this->lockQueue );
+
+            this->condQueueUpdate.wait( ctxWaitForWork,
+                [&]
+            {
+                return ( this->isThreadTerminating || this->entries.empty() == false );
+            });
+
+            // Whatever is left is run by somebody else.
+            if ( this->isThreadTerminating )
+                break;
+        }
+
+        RunNext();
+    }
+}
+
+}
+}
@@ -0,0 +1,411 @@
+#include "StdInc.h"
+#include "StreamingRawCache.h"
+
+#include <cstring>
+
+namespace krt
+{
+namespace streaming
+{
+
+// Simple LZ77 compression, in the spirit of LZ4.
+// It is not meant to compress well, just well enough for being cheap on the streaming threads.
+// Data is a sequence of
+//   token (literal count in the high nibble, match length minus LZ_MIN_MATCH in the low nibble),
+//   more literal count bytes if the nibble is 15, literals,
+//   match offset (2 bytes, little endian), more match length bytes if the nibble is 15.
+// The last sequence only has literals.
+static const size_t LZ_MIN_MATCH = 4;
+static const size_t LZ_MAX_OFFSET = 65535;
+static const unsigned int LZ_HASH_BITS = 12;
+
+static inline unsigned int ReadWord( const unsigned char *ptr )
+{
+    unsigned int word;
+    memcpy( &word, ptr, sizeof( word ) );
+
+    return word;
+}
+
+static inline unsigned int HashWord( unsigned int word )
+{
+    return ( ( word * 2654435761u ) >> ( 32 - LZ_HASH_BITS ) );
+}
+
+static void WriteLength( std::vector <unsigned char>& out, size_t length )
+{
+    while ( length >= 255 )
+    {
+        out.push_back( 255 );
+
+        length -= 255;
+    }
+
+    out.push_back( (unsigned char)length );
+}
+
+static bool ReadLength( const unsigned char *src, size_t srcSize, size_t& srcPos, size_t& lengthOut )
+{
+    while ( true )
+    {
+        if ( srcPos >= srcSize )
+            return false;
+
+        unsigned char part = src[ srcPos++ ];
+
+        lengthOut += part;
+
+        if ( part != 255 )
+            return true;
+    }
+}
+
+static void WriteSequence( std::vector <unsigned char>& out, const unsigned char *literals, size_t numLiterals, size_t matchOffset, size_t matchLength )
+{
+    size_t literalToken = ( numLiterals < 15 ? numLiterals : 15 );
+    size_t matchToken = 0;
+
+    if ( matchLength != 0 )
+    {
+        matchToken = ( matchLength - LZ_MIN_MATCH );
+
+        if ( matchToken > 15 )
+        {
+            matchToken = 15;
+        }
+    }
+
+    out.push_back( (unsigned char)( ( literalToken << 4 ) | matchToken ) );
+
+    if ( literalToken == 15 )
+    {
+        WriteLength( out, numLiterals - 15 );
+    }
+
+    out.insert( out.end(), literals, literals + numLiterals );
+
+    if ( matchLength != 0 )
+    {
+        out.push_back( (unsigned char)( matchOffset & 0xFF ) );
+        out.push_back( (unsigned char)( matchOffset >> 8 ) );
+
+        if ( matchToken == 15 )
+        {
+            WriteLength( out, matchLength - LZ_MIN_MATCH - 15 );
+        }
+    }
+}
+
+// Returns false if the data does not get any smaller.
+static bool CompressLZ( const unsigned char *src, size_t srcSize, std::vector <unsigned char>& out )
+{
+    // Positions are kept in 32 bits.
+    if ( srcSize > 0xFFFFFFFF )
+        return false;
+
+    unsigned int hashTable[ 1 << LZ_HASH_BITS ] = { 0 };
+
+    out.clear();
+    out.reserve( srcSize );
+
+    size_t anchor = 0;
+    size_t pos = 0;
+
+    while ( pos + LZ_MIN_MATCH <= srcSize )
+    {
+        unsigned int word = ReadWord( src + pos );
+
+        unsigned int& hashEntry = hashTable[ HashWord( word ) ];
+
+        size_t candidate = hashEntry;
+
+        hashEntry = (unsigned int)pos;
+
+        size_t offset = ( pos - candidate );
+
+        if ( offset == 0 || offset > LZ_MAX_OFFSET || ReadWord( src + candidate ) != word )
+        {
+            // Skip faster through data that does not compress.
+            pos += 1 + ( ( pos - anchor ) >> 6 );
+            continue;
+        }
+
+        size_t matchLength = LZ_MIN_MATCH;
+
+        while ( pos + matchLength < srcSize && src[ candidate + matchLength ] == src[ pos + matchLength ] )
+        {
+            matchLength++;
+        }
+
+        WriteSequence( out, src + anchor, pos - anchor, offset, matchLength );
+
+        pos += matchLength;
+        anchor = pos;
+
+        if ( out.size() >= srcSize )
+            return false;
+    }
+
+    WriteSequence( out, src + anchor, srcSize - anchor, 0, 0 );
+
+    return ( out.size() < srcSize );
+}
+
+// Returns false if the data is broken.
+static bool DecompressLZ( const unsigned char *src, size_t srcSize, unsigned char *dst, size_t dstSize )
+{
+    size_t srcPos = 0;
+    size_t dstPos = 0;
+
+    while ( true )
+    {
+        if ( srcPos >= srcSize )
+            return false;
+
+        unsigned char token = src[ srcPos++ ];
+
+        size_t numLiterals = ( token >> 4 );
+
+        if ( numLiterals == 15 && ReadLength( src, srcSize, srcPos, numLiterals ) == false )
+            return false;
+
+        if ( numLiterals > ( srcSize - srcPos ) || numLiterals > ( dstSize - dstPos ) )
+            return false;
+
+        memcpy( dst + dstPos, src + srcPos, numLiterals );
+
+        srcPos += numLiterals;
+        dstPos += numLiterals;
+
+        // The last sequence does not have a match.
+        if ( srcPos == srcSize )
+            break;
+
+        if ( ( srcSize - srcPos ) < 2 )
+            return false;
+
+        size_t offset = ( src[ srcPos ] | ( src[ srcPos + 1 ] << 8 ) );
+
+        srcPos += 2;
+
+        size_t matchLength = ( token & 15 );
+
+        if ( matchLength == 15 && ReadLength( src, srcSize, srcPos, matchLength ) == false )
+            return false;
+
+        matchLength += LZ_MIN_MATCH;
+
+        if ( offset == 0 || offset > dstPos || matchLength > ( dstSize - dstPos ) )
+            return false;
+
+        // Matches can overlap with themselves, so copy byte by byte.
+        const unsigned char *matchPtr = ( dst + dstPos - offset );
+
+        for ( size_t n = 0; n < matchLength; n++ )
+        {
+            dst[ dstPos + n ] = matchPtr[ n ];
+        }
+
+        dstPos += matchLength;
+    }
+
+    return ( dstPos == dstSize );
+}
+
+StreamingRawCache::StreamingRawCache( void ) : maxMemory( 0 ), isCompressing( false ), memoryInUse( 0 ), rawDataSize( 0 ), numHits( 0 ), numMisses( 0 )
+{
+    return;
+}
+
+void StreamingRawCache::Store( ident_t id, const void *data, size_t dataSize )
+{
+    // Data that is bigger than the whole cache would just push everything else out.
+    if ( IsEnabled() == false || dataSize > this->maxMemory )
+        return;
+
+    {
+        std::unique_lock <std::mutex> ctxCheckEntry( this->lockEntries );
+
+        auto iter = this->entries.find( id );
+
+        if ( iter != this->entries.end() )
+        {
+            this->lruList.splice( this->lruList.end(), this->lruList, iter->second.lruNode );
+            return;
+        }
+    }
+
+    // Compress outside of the lock, so that the other threads can use the cache in the meantime.
+    entry_t newEntry;
+    newEntry.dataSize = dataSize;
+    newEntry.isCompressed = false;
+
+    if ( this->isCompressing )
+    {
+        std::vector <unsigned char> compressed;
+
+        if ( CompressLZ( (const unsigned char*)data, dataSize, compressed ) )
+        {
+            compressed.shrink_to_fit();
+
+            newEntry.data = std::make_shared <const std::vector <unsigned char>> ( std::move( compressed ) );
+            newEntry.isCompressed = true;
+        }
+    }
+
+    if ( newEntry.isCompressed == false )
+    {
+        const unsigned char *bytes = (const unsigned char*)data;
+
+        newEntry.data = std::make_shared <const std::vector <unsigned char>> ( bytes, bytes + dataSize );
+    }
+
+    size_t entrySize = newEntry.data->size();
+
+    std::unique_lock <std::mutex> ctxAddEntry( this->lockEntries );
+
+    // The budget could have changed in the meantime.
+    size_t maxMemory = this->maxMemory;
+
+    if ( entrySize > maxMemory )
+        return;
+
+    // Somebody else was faster.
+    if ( this->entries.find( id ) != this->entries.end() )
+        return;
+
+    TrimNoLock( maxMemory - entrySize );
+
+    newEntry.lruNode = this->lruList.insert( this->lruList.end(), id );
+
+    this->memoryInUse += entrySize;
+    this->rawDataSize += dataSize;
+
+    this->entries.insert( std::make_pair( id, std::move( newEntry ) ) );
+}
+
+bool StreamingRawCache::Fetch( ident_t id, void *dataBuf, size_t dataSize )
+{
+    if ( IsEnabled() == false )
+        return false;
+
+    data_t data;
+    bool isCompressed = false;
+    {
+        std::unique_lock <std::mutex> ctxTakeEntry( this->lockEntries );
+
+        auto iter = this->entries.find( id );
+
+        if ( iter == this->entries.end() || iter->second.dataSize != dataSize )
+        {
+            this->numMisses++;
+            return false;
+        }
+
+        data = iter->second.data;
+        isCompressed = iter->second.isCompressed;
+
+        this->lruList.splice( this->lruList.end(), this->lruList, iter->second.lruNode );
+    }
+
+    if ( isCompressed )
+    {
+        if ( DecompressLZ( data->data(), data->size(), (unsigned char*)dataBuf, dataSize ) == false )
+        {
+            // Should never happen, but the device still has the data.
+            Remove( id );
+
+            this->numMisses++;
+            return false;
+        }
+    }
+    else if ( dataSize != 0 )
+    {
+        memcpy( dataBuf, data->data(), dataSize );
+    }
+
+    this->numHits++;
+    return true;
+}
+
+bool StreamingRawCache::Contains( ident_t id ) const
+{
+    if ( IsEnabled() == false )
+        return false;
+
+    std::unique_lock <std::mutex> ctxCheckEntry( this->lockEntries );
+
+    return ( this->entries.find( id ) != this->entries.end() );
+}
+
+void StreamingRawCache::Touch( ident_t id )
+{
+    if ( IsEnabled() == false )
+        return;
+
+    std::unique_lock <std::mutex> ctxTouchEntry( this->lockEntries );
+
+    auto iter = this->entries.find( id );
+
+    if ( iter != this->entries.end() )
+    {
+        this->lruList.splice( this->lruList.end(), this->lruList, iter->second.lruNode );
+    }
+}
+
+void StreamingRawCache::Remove( ident_t id )
+{
+    std::unique_lock <std::mutex> ctxRemoveEntry( this->lockEntries );
+
+    auto iter = this->entries.find( id );
+
+    if ( iter != this->entries.end() )
+    {
+        RemoveEntryNoLock( iter );
+    }
+}
+
+void StreamingRawCache::SetMaxMemory( size_t maxMemory )
+{
+    std::unique_lock <std::mutex> ctxSetBudget( this->lockEntries );
+
+    this->maxMemory = maxMemory;
+
+    TrimNoLock( maxMemory );
+}
+
+void StreamingRawCache::SetCompression( bool isCompressing )
+{
+    this->isCompressing = isCompressing;
+}
+
+void StreamingRawCache::ResetStatistics( void )
+{
+    this->numHits = 0;
+    this->numMisses = 0;
+}
+
+// only THREAD-SAFE if called from lockEntries !
+void StreamingRawCache::RemoveEntryNoLock( std::unordered_map <ident_t, entry_t>::iterator iter )
+{
+    const entry_t& entry = iter->second;
+
+    this->memoryInUse -= entry.data->size();
+    this->rawDataSize -= entry.dataSize;
+
+    this->lruList.erase( entry.lruNode );
+
+    this->entries.erase( iter );
+}
+
+// only THREAD-SAFE if called from lockEntries !
+void StreamingRawCache::TrimNoLock( size_t maxMemory )
+{
+    while ( this->memoryInUse > maxMemory && this->lruList.empty() == false )
+    {
+        RemoveEntryNoLock( this->entries.find( this->lruList.front() ) );
+    }
+}
+
+}
+}
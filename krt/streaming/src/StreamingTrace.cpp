@@ -0,0 +1,60 @@
+#include "StdInc.h"
+#include "StreamingTrace.h"
+
+#include <chrono>
+
+namespace krt
+{
+namespace streaming
+{
+
+static unsigned long long GetTraceTime( void )
+{
+    return (unsigned long long)std::chrono::duration_cast <std::chrono::microseconds> (
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+StreamingTraceRecorder::StreamingTraceRecorder( writer_t writer ) : writer( std::move( writer ) )
+{
+    this->startTime = GetTraceTime();
+
+    this->records.reserve( MAX_BUFFERED_RECORDS );
+}
+
+StreamingTraceRecorder::~StreamingTraceRecorder( void )
+{
+    Flush();
+}
+
+void StreamingTraceRecorder::Record( StreamingTraceRecord::eType type, ident_t id, unsigned int arg0, unsigned int arg1, unsigned int arg2, unsigned int arg3 )
+{
+    StreamingTraceRecord record;
+    record.type = type;
+    record.id = id;
+    record.time = ( GetTraceTime() - this->startTime );
+    record.args[0] = arg0;
+    record.args[1] = arg1;
+    record.args[2] = arg2;
+    record.args[3] = arg3;
+
+    this->records.push_back( record );
+
+    if ( this->records.size() >= MAX_BUFFERED_RECORDS )
+    {
+        Flush();
+    }
+}
+
+void StreamingTraceRecorder::Flush( void )
+{
+    if ( this->records.empty() )
+        return;
+
+    this->writer( this->records.data(), this->records.size() * sizeof( StreamingTraceRecord ) );
+
+    this->records.clear();
+}
+
+}
+}